@@ -4,29 +4,53 @@
 */
 
 #include "communication.h"
-#include "ir_uart.h"
+#include "ir_queue.h"
 #include "led.h"
-#include "navswitch.h"
-
-/* One Byte codes for communication over the ir. Including data codes, acknowledgements, and bitmasks for various data types that can be recieved. */
+#include "frame.h"
+#include "link.h"
+#include "lockstep.h"
+#include "physics.h"
+#include "geometry.h"
+#include <stddef.h>
+#include <avr/pgmspace.h>
+
+/* One Byte codes for starting the game over the ir, these are sent outside of frames as either funkit may send first. Each seam of the court
+    (see geometry.h) has its own codes, so a start code is only answered by the board across that seam. */
 #define BLANK_BYTE 0xFF
-#define START_CODE 0xFE
-#define START_ACK 0xFD
-#define END_CODE 0xFC
-#define END_ACK 0xFB
-#define GAME_OVER_CODE 0xFA
-/* Physics ir transfer method: two bytes are transferred over ir each time the ball goes across the screen, within these two bytes there is a 4 bir prefix
-    containing a sequence number in the range 0-7, and all other codes must use a prefix out of this range. The last 4 bits are data bits, the first physics
-    packet contains the ball's row posistion in its data bits, and the second contains the row direction and column velocity magnitude. The sequence number is
-    used to recieve ack's and detect duplicate transmissions. As the sequence number is 0-7, four ball transfers will occur before the sequence number repeats,
-    so old transmissions will not be falsely detected as new data. */
-#define PREFIX_MASK 0xF0
-#define SUFFIX_MASK 0x0F
-#define THREE_MASK 0x07
-#define ONE_MASK 0x08
-/* Physics acknowledgement prefix, the last 4 bits are set to the sequence number. */
-#define PHYSICS_ACK 0xD0
-#define SEQ_NUMBER_LIMIT 8
+#define START_CODE(seam) (0xFE - 2 * (seam))
+#define START_ACK(seam) (0xFD - 2 * (seam))
+/* The seam between this funkit and a link peer. */
+#define PEER_SEAM(peer) (GEOMETRY_SEAM + (peer))
+
+/* Message types sent over the link once the game has started, see link.h. The link delivers each message once and in order, so messages can be
+    queued behind each other without waiting for acknowledgements. The physics message holds the full position and velocity of the ball. The
+    row takes the low BALL_ROW_BITS of its two bytes, and the bits above it hold the low bits of the shared frame (see link_frame) the message
+    was sent on, which place the crossing to the frame once the held count and link latency have placed it to within half their range. */
+#define MESSAGE_PHYSICS 0x00
+#define MESSAGE_END_ROUND 0x01
+#define MESSAGE_GAME_OVER 0x02
+#define NUM_MESSAGE_TYPES 3
+#define PHYSICS_MESSAGE_LENGTH 4
+#define BALL_ROW_BITS 10
+#define BALL_ROW_MASK (BIT(BALL_ROW_BITS) - 1)
+#define BALL_FRAME_BITS (16 - BALL_ROW_BITS)
+#define BALL_FRAME_MASK (BIT(BALL_FRAME_BITS) - 1)
+
+_Static_assert(PHYSICS_MESSAGE_LENGTH <= LINK_MAX_MESSAGE, "the physics message doesn't fit a link frame");
+_Static_assert(GEOMETRY_ROWS * PHYSICS_SUBPIXEL <= BIT(BALL_ROW_BITS), "the ball's row doesn't fit the physics message");
+
+/* During a round LED1 blinks once the link loss estimate (see link_loss) passes QUALITY_BLINK_LOSS, with a shorter period the more messages
+    are lost, so the players can tell when to line the funkits up again. The led is on and off for QUALITY_MIN_BLINK_FRAMES at the most loss. */
+#define QUALITY_BLINK_LOSS (LINK_MAX_LOSS / 8)
+#define QUALITY_MIN_BLINK_FRAMES 2
+#define QUALITY_BLINK_SHIFT 4
+
+/* Number of events that can be queued for the game in a frame, must be a power of two so the indexes can wrap with a mask. Each byte or
+    message recieved queues at most one event, the rest are left buffered for the next frame once the queue is full. */
+#define EVENT_QUEUE_SIZE 4
+#define EVENT_MASK (EVENT_QUEUE_SIZE - 1)
+
+_Static_assert(sizeof(CommunicationEvent_t) == 1, "communication events should pack in to a byte");
 
 /* Communication states. */
 typedef enum {
@@ -34,321 +58,407 @@ typedef enum {
     START_SEND,
     RECIEVING,
     WAITING,
-    SENDING,
     END_ROUND,
-    GAME_OVER
+    GAME_OVER,
+    NUM_STATES
 } CommunicationState_t;
 
-/* Construct an empty communication packet. */
-static CommunicationPacket_t null_packet(void)
-{
-    CommunicationPacket_t packet = {
-        .startGame = false,
-        .haveBall = false,
-        .endRound = false,
-        .physicsInfo = false,
-        .gameOver = false,
-    };
-    return packet;
-} 
+/* Classes of everything recieved, the link message types come first so a message's type is its class. A new message type only needs a
+    class here and a column in the transition table. */
+typedef enum {
+    CLASS_PHYSICS = MESSAGE_PHYSICS,
+    CLASS_END_ROUND = MESSAGE_END_ROUND,
+    CLASS_GAME_OVER = MESSAGE_GAME_OVER,
+    CLASS_START_CODE = NUM_MESSAGE_TYPES,
+    CLASS_START_ACK,
+    NUM_CLASSES
+} MessageClass_t;
+
+/* What is done with something recieved, see communication_dispatch. */
+typedef enum {
+    ACTION_IGNORE,
+    ACTION_JOIN,
+    ACTION_START,
+    ACTION_YIELD,
+    ACTION_REPLY,
+    ACTION_FORWARDED,
+    ACTION_BALL,
+    ACTION_END_ROUND,
+    ACTION_GAME_OVER
+} Action_t;
+
+/* The action for each class recieved in each state, kept in flash. The other funkit only sends messages while it believes the ball is on our
+    side, so they are only acted on while RECIEVING, and start codes are only answered while setting up or just after the round has started. */
+static const uint8_t transitions[NUM_STATES][NUM_CLASSES] PROGMEM = {
+    /*              PHYSICS          END_ROUND          GAME_OVER          START_CODE     START_ACK */
+    [START_REC]  = {ACTION_IGNORE,   ACTION_IGNORE,     ACTION_IGNORE,     ACTION_JOIN,   ACTION_IGNORE},
+    [START_SEND] = {ACTION_IGNORE,   ACTION_IGNORE,     ACTION_IGNORE,     ACTION_YIELD,  ACTION_START},
+    [RECIEVING]  = {ACTION_BALL,     ACTION_END_ROUND,  ACTION_GAME_OVER,  ACTION_REPLY,  ACTION_FORWARDED},
+    [WAITING]    = {ACTION_IGNORE,   ACTION_IGNORE,     ACTION_IGNORE,     ACTION_REPLY,  ACTION_FORWARDED},
+    [END_ROUND]  = {ACTION_IGNORE,   ACTION_IGNORE,     ACTION_IGNORE,     ACTION_IGNORE, ACTION_IGNORE},
+    [GAME_OVER]  = {ACTION_IGNORE,   ACTION_IGNORE,     ACTION_IGNORE,     ACTION_IGNORE, ACTION_IGNORE}
+};
 
-/** Construct a communication packet indicating the game has started.
- * @param haveBall Whether this board starts with the ball on their side.
- * @return A communication packet with the startGame flag true.
-*/
-static CommunicationPacket_t game_start_packet(bool haveBall)
-{
-    CommunicationPacket_t packet = null_packet();
-    packet.startGame = true;
-    packet.haveBall = haveBall;
-    return packet;
-}
+/* The current communication state, this is updated by public function calls or by recieved data. */
+static CommunicationState_t currentState;
 
-/** Construct a communication packet indicating the round has ended.
- * @return A communication packet with the endRound flag set to true.
-*/
-static CommunicationPacket_t end_round_packet(void)
-{
-    CommunicationPacket_t packet = null_packet();
-    packet.endRound = true;
-    return packet;
-}
+/* A start code reply owed to the other funkit, queued as soon as there is room. BLANK_BYTE if there is no reply to send. */
+static uint8_t pendingReply = BLANK_BYTE;
 
-/** Construct a communication packet with physics infomation of the ball's state.
- * @param posR The row posistion of the ball (0-6)
- * @param dirR Whether the ball is moving positively in the row direction.
- * @param magC The magnitude of the velocity in the column direction.
- * @return The packet with the physicsInfo flag set true and the infomation included.
-*/
-static CommunicationPacket_t communication_physics_packet(uint8_t posR, bool dirR, uint8_t magC)
-{
-    CommunicationPacket_t packet = null_packet();
-    packet.physicsInfo = true;
-    /* Take only the lowest three bits of these parameters, as only three bits are transferred over the ir. */
-    packet.posR = posR & THREE_MASK;
-    packet.magC = magC & THREE_MASK;
-    packet.dirR = dirR;
-    return packet;
-}
+/* Whether the end of round or game over message has been queued on the link yet, it is queued once on entering those states. */
+static bool endQueued = false;
 
-/** Construct a communication packet indicating the game has ended.
- * @return A communication packet with the gameOver flag set to true.
-*/
-static CommunicationPacket_t end_game_packet(void) {
-    CommunicationPacket_t packet = null_packet();
-    packet.gameOver = true;
-    return packet;
-}
+/* The link peer the end of round or game over message is sent to, a relay passes it on away from the board it came from. */
+static uint8_t endPeer = LINK_PEER_FRONT;
 
-/* The current sequence number of the data being sent over ir, used to order the physics data being sent over multiple transistions. */
-static uint8_t physicsSeqNumber = 0;
-/* The physics packet to send/recieve over ir. */
-static CommunicationPacket_t physicsPacket;
+/* The link peer whose start code started this round, its repeated start codes are still answered. */
+static uint8_t startPeer = LINK_PEER_FRONT;
 
-/* The current communication state, this is updated by public function calls or by recieved data. */
-static CommunicationState_t currentState;
+/* The start code a relay passes on to the board on its other side until it is acknowledged, BLANK_BYTE if there is none to send. */
+static uint8_t startForward = BLANK_BYTE;
+
+/* Decoder for frames recieved over ir. */
+static FrameDecoder_t decoder;
+
+/* Frames into the current blink of the link quality indicator. */
+static uint8_t blinkFrames = 0;
+
+/* Events for the game, queued by communication_update and taken by communication_next_event. One slot is left empty to tell a full queue
+    from an empty one. */
+static CommunicationEvent_t events[EVENT_QUEUE_SIZE];
+static uint8_t eventHead = 0;
+static uint8_t eventTail = 0;
+
+/* The state of the last ball recieved. */
+static CommunicationBall_t ball;
 
-/** Initializes communication, calling API functions to initialize the led and ir, and setting the initial state. */
+/** Initializes communication, calling API functions to initialize the led and ir, and setting the initial state. Relay boards (see geometry.h)
+    can't start the game, they join it when a start code reaches them and pass it on, and pass on every end of round. */
 void communication_init(void)
 {
     led_init();
-    ir_uart_init();
+    ir_queue_init();
+    link_init();
+    frame_decoder_init(&decoder);
     currentState = START_REC;
-    physicsPacket = null_packet();
-    physicsPacket.physicsInfo = true;
+    pendingReply = BLANK_BYTE;
+    startPeer = LINK_PEER_FRONT;
+    startForward = BLANK_BYTE;
+    blinkFrames = 0;
+    eventHead = 0;
+    eventTail = 0;
 }
 
-/** Ends the current round. */
+/** Ends the current round, the end is queued on the link for the other funkit by communication_update once the window has room. */
 void communication_send_end_round(void)
 {
     currentState = END_ROUND;
+    endQueued = false;
+    endPeer = LINK_PEER_FRONT;
 }
 
-/** Ends the game. */
+/** Ends the game, the end is queued on the link for the other funkit by communication_update once the window has room. */
 void communication_send_end_game(void)
 {
     currentState = GAME_OVER;
+    endQueued = false;
+    endPeer = LINK_PEER_FRONT;
 }
 
-/** Sets the physics packet to be sent over ir, and sets the state to sending.
- * @param posR The row posistion of the ball.
- * @param dirR Whether the ball is moving positively in the row direction.
- * @param magC The magnitude of the velocity in the column direction.
+/** Ends the round or the game without telling the other funkit, for lockstep play where both funkits know when the round ends.
+ * @param gameOver True if the game has ended, otherwise the next round can be started.
 */
-void communication_send_physics_info(uint8_t posR, bool dirR, uint8_t magC)
+void communication_finish_round(bool gameOver)
 {
-    /* Can only transistion to the SENDING state if currently WAITING. */
+    currentState = gameOver ? GAME_OVER : START_REC;
+    endQueued = true;
+}
+
+/** Queues the ball's state to be sent over ir, and sets the state to recieving. Does nothing unless the state is waiting, which it stays in if
+ * the link's window is full, so the game calls this every frame the ball is off the board.
+ * @param ballPosR The row posistion of the ball in subpixels.
+ * @param ballVelR The velocity of the ball in the row direction.
+ * @param ballVelC The velocity of the ball in the column direction.
+ * @param toBack True if the ball left over the back edge of this relay board, otherwise it left over column 0.
+*/
+void communication_send_physics_info(int16_t ballPosR, int8_t ballVelR, int8_t ballVelC, bool toBack)
+{
+    /* Can only send the ball if it is on our side, i.e. WAITING. */
     if(currentState != WAITING) {
         return;
     }
-    currentState = SENDING;
-    /* Brief error handling for if the sequence number has got out of sync, as it should always be even at start of state. */
-    if(physicsSeqNumber % 2 == 1) {
-        physicsSeqNumber++;
+
+    uint16_t rowFrame = ((uint16_t)ballPosR & BALL_ROW_MASK) | ((uint16_t)link_frame() << BALL_ROW_BITS);
+    uint8_t data[PHYSICS_MESSAGE_LENGTH] = {
+        rowFrame & 0xFF,
+        rowFrame >> 8,
+        (uint8_t)ballVelR,
+        (uint8_t)ballVelC
+    };
+    /* If the window is full we stay WAITING, and the game calls again next frame. */
+    if(link_send(toBack ? LINK_PEER_BACK : LINK_PEER_FRONT, MESSAGE_PHYSICS, data, PHYSICS_MESSAGE_LENGTH)) {
+        currentState = RECIEVING;
     }
-    physicsPacket = communication_physics_packet(posR, dirR, magC);
 }
 
-/**
- * The communication state machine, updates state based on current state and recieved data from ir, and returns any data recieved.
- * @return A communication packet that can be checked for any flags or infomation recieved.
+/** Checks if there is room to queue another event for the game.
+ * @return True if communication_push_event can be called.
 */
-CommunicationPacket_t communication_update(void) {
-    /* Takes any input from the ir channel, and then perform behaviour based on the current state. See the switch statement for details about each state. */
-
-    /* The sequence number must always be in the range 0-7, so that other 4 bit prefixes are possible for the other data codes. */
-    physicsSeqNumber = physicsSeqNumber % SEQ_NUMBER_LIMIT;
-
-    /* The byte transmitted over ir, BLANK_BYTE is the code if no byte is recieved. This variable is static and persists between
-        function calls, because we may want to check it on a later frame than it is recieved, for this reason after this data has
-        been used it often needs to be reset to BLANK_BYTE. */
-    static uint8_t readData = BLANK_BYTE;
-
-    /* Whether a byte can be send over the ir channel on this frame. */
-    bool sendFrame = false;
-    static uint8_t tickCount = 0;
-    tickCount = (tickCount + 1) % 2;
-    if(tickCount == 0) {
-        if(ir_uart_write_ready_p()) {
-            sendFrame = true;
-        } else {
-            tickCount++;
-        }
-    }
+static bool communication_event_room_p(void)
+{
+    return ((eventHead + 1) & EVENT_MASK) != eventTail;
+}
 
-    /* Read a byte from the ir channel if there is a byte to read. */
-    if(ir_uart_read_ready_p()) {
-        readData = ir_uart_getc();
-    }
+/** Queues an event for the game, should only be called if communication_event_room_p is true.
+ * @param type The kind of event.
+ * @param haveBall Whether this board starts with the ball, for a game start.
+ * @param peer The funkit the event came from.
+*/
+static void communication_push_event(CommunicationEventType_t type, bool haveBall, uint8_t peer)
+{
+    CommunicationEvent_t event = {
+        .type = type,
+        .haveBall = haveBall,
+        .fromBack = peer == LINK_PEER_BACK
+    };
+    events[eventHead] = event;
+    eventHead = (eventHead + 1) & EVENT_MASK;
+}
 
-    led_set(LED1, false);
-
-    switch (currentState) {
-        case START_REC:
-            /* One of the two setup states. 
-                Transistion to START_SEND if the navswitch is pushed. 
-                Transistion to RECIEVING and return a game start packet where the ball is not on our side if the start code is recieved.
-                Also need to check for the end code, as after the end of a round we transistion back to this state, and so may still need to send end ack. */
-            
-            led_set(LED1, true);
-
-            if(readData == START_CODE) {
-                currentState = RECIEVING;
-                return game_start_packet(false);
-            } else if(readData == END_CODE && sendFrame) {
-                readData = BLANK_BYTE;
-                ir_uart_putc(END_ACK);
-                break;
+/** Takes the action the transition table gives for something recieved in the current state.
+ * @param messageClass What was recieved.
+ * @param peer The funkit it came from.
+ * @param message The recieved link message, NULL for a byte code.
+*/
+static void communication_dispatch(MessageClass_t messageClass, uint8_t peer, const LinkMessage_t* message)
+{
+    switch ((Action_t)pgm_read_byte(&transitions[currentState][messageClass])) {
+        case ACTION_JOIN:
+            /* Transistion to RECIEVING and queue a game start where the ball is not on our side.
+                A relay may be started from either side, and passes the start code on to the other. */
+            currentState = RECIEVING;
+            startPeer = peer;
+            pendingReply = START_ACK(PEER_SEAM(peer));
+            startForward = GEOMETRY_RELAY ? START_CODE(PEER_SEAM(!peer)) : BLANK_BYTE;
+            communication_push_event(COMMUNICATION_START_GAME, false, peer);
+            break;
+        case ACTION_START:
+            /* Our start code was acknowledged, transistion to WAITING and queue a game start with the ball on our side. */
+            currentState = WAITING;
+            communication_push_event(COMMUNICATION_START_GAME, true, peer);
+            break;
+        case ACTION_YIELD:
+            /* Both funkits entered the send state simultaeneously, let the other one start the game. */
+            currentState = START_REC;
+            break;
+        case ACTION_REPLY:
+            /* The other funkit keeps sending start codes until it hears our acknowledgement. */
+            if(peer == startPeer) {
+                pendingReply = START_ACK(PEER_SEAM(peer));
             }
-
-            navswitch_update();
-            if(navswitch_push_event_p(NAVSWITCH_PUSH)) {
-                currentState = START_SEND;
-                return null_packet();
+            break;
+        case ACTION_FORWARDED:
+            /* A relay keeps passing the start code on until the board on its other side acknowledges it. */
+            if(peer != startPeer) {
+                startForward = BLANK_BYTE;
             }
-
             break;
-        case START_SEND:
-            /* One of two setup states. Send start code on all send frames. 
-            Transistion to WAITING and return a game start packet with the ball on our side if a start acknowledgement is recieved.
-            Transistion to START_REC if a start code is recieved, just in case both funkits enter the send state simultaeneously.
-            Also need to check for the end code, as after the end of a round we transistion back to this state, and so may still need to send end ack. */
-
-            led_set(LED1, true);
-
-            if(readData == START_ACK) {
-                readData = BLANK_BYTE;
-                currentState = WAITING;
-                return game_start_packet(true);
-            } else if(readData == END_CODE && sendFrame) {
-                readData = BLANK_BYTE;
-                ir_uart_putc(END_ACK);
-                break;
-            } else if(readData == START_CODE) {
-                readData = BLANK_BYTE;
-                currentState = START_REC;
+        case ACTION_BALL:
+            /* The ball crosses on to this funkits side, transistion to WAITING. */
+            if(message->length != PHYSICS_MESSAGE_LENGTH) {
                 break;
             }
-
-            if(sendFrame) {
-                ir_uart_putc(START_CODE);
+            currentState = WAITING;
+            uint16_t rowFrame = message->data[0] | (message->data[1] << 8);
+            ball.ballPosR = rowFrame & BALL_ROW_MASK;
+            ball.ballVelR = (int8_t)message->data[2];
+            ball.ballVelC = (int8_t)message->data[3];
+            /* The ball left the other funkit the frames it held the message for before the copy that arrived, and that copy's latency, ago.
+                Once the shared frames are in step that is moved to the nearest count that matches the frames since the one it was sent on,
+                counting this frame, whose link_update is still to come. */
+            ball.hopFrames = message->held > UINT8_MAX - link_latency(peer) ? UINT8_MAX : message->held + link_latency(peer);
+            if(link_frame_synced_p()) {
+                uint8_t error = (link_frame() + 1 - (rowFrame >> BALL_ROW_BITS) - ball.hopFrames) & BALL_FRAME_MASK;
+                int16_t hopFrames = ball.hopFrames + (error > BALL_FRAME_MASK / 2 ? (int16_t)error - BIT(BALL_FRAME_BITS) : error);
+                if(hopFrames >= 0 && hopFrames <= UINT8_MAX) {
+                    ball.hopFrames = hopFrames;
+                }
             }
-
+            communication_push_event(COMMUNICATION_BALL, false, peer);
             break;
-        case RECIEVING:
-            /* Recieve the ball's state from the other funkit when the ball crosses the edge of the screen. physicsSeqNumber is used to tell which byte we want to recieve,
-                and the infomation is stored in physicsPacket until we can return it. We also need to sends acks if we recieve a start code.
-                Transistion to GAME_OVER or START_REC if the game or round ends.
-                Return the physicsPacket and transistion to WAITING once the last physics byte is recieved. */
-
-            if(readData == START_CODE && sendFrame) {
-                ir_uart_putc(START_ACK);
-                readData = BLANK_BYTE;
-                break;
+        case ACTION_END_ROUND:
+            /* A relay passes the end of the round on to the board on its other side, and starts the next round once that is acknowledged. */
+            if(GEOMETRY_RELAY) {
+                currentState = END_ROUND;
+                endQueued = false;
+                endPeer = !peer;
+                startForward = BLANK_BYTE;
+            } else {
+                currentState = START_REC;
             }
+            communication_push_event(COMMUNICATION_END_ROUND, false, peer);
+            break;
+        case ACTION_GAME_OVER:
+            currentState = GAME_OVER;
+            endQueued = !GEOMETRY_RELAY;
+            endPeer = !peer;
+            startForward = BLANK_BYTE;
+            communication_push_event(COMMUNICATION_GAME_OVER, false, peer);
+            break;
+        default:
+            break;
+    }
+}
 
-            if(readData == GAME_OVER_CODE) {
-                readData = BLANK_BYTE;
-                currentState = GAME_OVER;
-                return end_game_packet();
+/** Handles the link messages recieved while there is room in the event queue. Message types this funkit doesn't know are ignored. */
+static void communication_deliver(void)
+{
+    LinkMessage_t message;
+    for(uint8_t peer = 0; peer < LINK_NUM_PEERS; peer++) {
+        while(communication_event_room_p() && link_read(peer, &message)) {
+            if(message.type < NUM_MESSAGE_TYPES) {
+                communication_dispatch((MessageClass_t)message.type, peer, &message);
             }
+        }
+    }
+}
 
-            if(readData == END_CODE) {
-                readData = BLANK_BYTE;
-                currentState = START_REC;
-                return end_round_packet();
-            }
+/** Handles a single byte code recieved from the ir channel outside of a frame, these are only used to start the game. The start code and
+    acknowledgement of each seam sit next to each other counting down from 0xFE, so the seam, and so the peer, comes straight from the byte.
+ * @param readData The recieved byte.
+*/
+static void communication_receive(uint8_t readData)
+{
+    uint8_t offset = START_CODE(0) - readData;
+    uint8_t peer = (offset >> 1) - GEOMETRY_SEAM;
+    if(peer < LINK_NUM_PEERS) {
+        communication_dispatch((offset & 1) ? CLASS_START_ACK : CLASS_START_CODE, peer, NULL);
+    }
+}
 
-            /* Send acks for any packet we recieve and store physics infomation if we recieve a packet with the current sequence number. */
-            uint8_t seqNumber = (readData & PREFIX_MASK) >> 4;
-            uint8_t lastPhyisicsSeq = (physicsSeqNumber + SEQ_NUMBER_LIMIT - 1) % SEQ_NUMBER_LIMIT;
-            uint8_t data = readData & SUFFIX_MASK;
-            if(seqNumber == physicsSeqNumber) {
-                if(sendFrame) {
-                    readData = BLANK_BYTE;
-                    ir_uart_putc(PHYSICS_ACK | physicsSeqNumber);
-                }
+/** Steps the link quality indicator on by a frame, see QUALITY_BLINK_LOSS.
+ * @return True if the led should be on this frame.
+*/
+static bool communication_quality_led(void)
+{
+    uint8_t loss = 0;
+    for(uint8_t peer = 0; peer < LINK_NUM_PEERS; peer++) {
+        if(link_loss(peer) > loss) {
+            loss = link_loss(peer);
+        }
+    }
+    if(loss < QUALITY_BLINK_LOSS) {
+        blinkFrames = 0;
+        return false;
+    }
 
-                if(physicsSeqNumber % 2 == 0) {
-                    physicsPacket.posR = data;
-                    physicsSeqNumber++;
-                } else {
-                    physicsPacket.dirR = (data & ONE_MASK) > 0;
-                    physicsPacket.magC = data & THREE_MASK;
-                    physicsSeqNumber++;
-                    currentState = WAITING;
-                    return physicsPacket;
-                }
-            } else if(seqNumber == lastPhyisicsSeq && sendFrame) {
-                readData = BLANK_BYTE;
-                ir_uart_putc(PHYSICS_ACK | lastPhyisicsSeq);
-            }
+    uint8_t halfPeriod = QUALITY_MIN_BLINK_FRAMES + ((LINK_MAX_LOSS - loss) >> QUALITY_BLINK_SHIFT);
+    if(++blinkFrames >= 2 * halfPeriod) {
+        blinkFrames = 0;
+    }
+    return blinkFrames < halfPeriod;
+}
 
-            break;
-        case WAITING: ;
-            /* The state while the ball is on this funkits side, checks for if the last physics seq number is still being transmitted (if other funkit is still
-                in SENDING state), and send acknowledgement if so. */
-
-            uint8_t lastPhysicsSeqNumber = (physicsSeqNumber + SEQ_NUMBER_LIMIT - 1) % SEQ_NUMBER_LIMIT;
-            uint8_t recievedSeqNumber = (readData & PREFIX_MASK) >> 4;
-            if(recievedSeqNumber == lastPhysicsSeqNumber && sendFrame) {
-                readData = BLANK_BYTE;
-                ir_uart_putc(PHYSICS_ACK | lastPhysicsSeqNumber);
-            }
+/** Performs the per frame behaviour of the current state, queueing as much as the ir transmit buffer can take.
+ * @param input The input for this frame.
+*/
+static void communication_transmit(Input_t input)
+{
+    /* The led is on while waiting for the game to start, and shows the link quality during a round. */
+    if(currentState == RECIEVING || currentState == WAITING) {
+        led_set(LED1, communication_quality_led());
+    } else {
+        led_set(LED1, currentState == START_REC || currentState == START_SEND);
+    }
 
-            break;
-        case SENDING:
-            /* Sends the ball's state over ir when the ball reaches the edge of the screen. The data from physicsPacket is sent over the ir channel, 
-                with physicsSeqNumber keeping track of whether we are transfering the first or second byte, which we update once ack recieved.
-                Transistion to RECIEVING once an acknowledgement for the second byte is recieved. */
-
-            if((readData & PREFIX_MASK) == PHYSICS_ACK) {
-                if((readData & SUFFIX_MASK) == physicsSeqNumber) {
-                    readData = BLANK_BYTE;
-                    if(physicsSeqNumber % 2 == 0) {
-                        physicsSeqNumber++;
-                    } else {
-                        physicsSeqNumber++;
-                        currentState = RECIEVING;
-                        break;
-                    }
-                }
-            }
+    /* Transistion to START_SEND if the navswitch is pushed while waiting for the game to start, only the players' boards can start it. */
+    if(currentState == START_REC && input.push && !GEOMETRY_RELAY) {
+        currentState = START_SEND;
+    }
 
-            if(sendFrame) {
-                uint8_t seqCode = physicsSeqNumber << 4;
-                if(physicsSeqNumber % 2 == 0) {
-                    ir_uart_putc(seqCode | physicsPacket.posR);
-                } else {
-                    ir_uart_putc(seqCode | (THREE_MASK & physicsPacket.magC) | (physicsPacket.dirR ? ONE_MASK : 0x00));
-                }
-            }
+    /* Queue the end of round or game over message, retrying each frame while the window is full. The round only ends once the
+        other funkit has acknowledged everything, so the next start code can't overtake the end of round message. */
+    if((currentState == END_ROUND || currentState == GAME_OVER) && !endQueued) {
+        endQueued = link_send(endPeer, currentState == END_ROUND ? MESSAGE_END_ROUND : MESSAGE_GAME_OVER, NULL, 0);
+    }
+    if(currentState == END_ROUND && endQueued && link_idle_p()) {
+        currentState = START_REC;
+    }
 
-            break;
-        case END_ROUND:
-            /* The end round state, sends a end code to the other funkit every send frame, and waits for an acknowledgement.
-                Transistion to START_REC after acknowledgement recieved. */
+    link_update();
 
-            if(readData == END_ACK) {
-                currentState = START_REC;
-                readData = BLANK_BYTE;
-                break;
-            }
+    /* Replies to the other funkit take priority, as it may be retransmitting until it hears them. */
+    if(pendingReply != BLANK_BYTE && ir_queue_putc(pendingReply)) {
+        pendingReply = BLANK_BYTE;
+    }
 
-            if(sendFrame) {
-                ir_uart_putc(END_CODE);
-            }
+    while(link_transmit()) {
+        continue;
+    }
 
-            break;
-        case GAME_OVER:
-            /* Send code to other funkit to notify it that the game is over. */
+    /* Send the start code until acknowledged, only once the previous one has gone so the buffer doesn't fill up with them. */
+    if(currentState == START_SEND && ir_queue_write_empty_p()) {
+        ir_queue_putc(START_CODE(GEOMETRY_SEAM));
+    }
+    if(startForward != BLANK_BYTE && ir_queue_write_empty_p()) {
+        ir_queue_putc(startForward);
+    }
+}
 
-            if(sendFrame) {
-                ir_uart_putc(GAME_OVER_CODE);
-            }
+/** Checks if communication has nothing to send until a byte is recieved or the navswitch is pushed, so frames can be slept through.
+ * @return True if waiting for the game to start, or the game is over, with nothing left to send.
+*/
+bool communication_idle_p(void)
+{
+    return (currentState == START_REC || (currentState == GAME_OVER && endQueued)) && pendingReply == BLANK_BYTE && startForward == BLANK_BYTE
+        && link_quiet_p();
+}
 
-            break;
+/**
+ * The communication state machine, updates state based on current state and recieved data from ir, queueing any events recieved.
+ * @param input The input for this frame, a push starts the game.
+*/
+void communication_update(Input_t input) {
+    /* Messages left over from the last frame are delivered first, then every byte buffered by the receive interrupt is drained. If the event
+        queue fills the rest are left buffered for the next frame, so they are delayed rather than lost. */
+    communication_deliver();
+    while(communication_event_room_p() && ir_queue_read_ready_p()) {
+        uint8_t readData = ir_queue_getc();
+        FrameResult_t result = frame_decode(&decoder, readData);
+        if(result == FRAME_BYTE) {
+            communication_receive(readData);
+        } else if(result == FRAME_COMPLETE) {
+            /* Each ignores the other's frames, see link.h. Only the lockstep build has lockstep frames. */
+            link_receive_frame(decoder.payload, decoder.length);
+#ifdef LOCKSTEP
+            lockstep_receive_frame(decoder.payload, decoder.length);
+#endif
+            communication_deliver();
+        }
     }
-    
-    return null_packet();
-}
\ No newline at end of file
+
+    communication_transmit(input);
+}
+
+/** Takes the oldest event queued by communication_update, every event should be taken before the next update.
+ * @param event Filled in with the event.
+ * @return False if there are no more events.
+*/
+bool communication_next_event(CommunicationEvent_t* event)
+{
+    if(eventHead == eventTail) {
+        return false;
+    }
+    *event = events[eventTail];
+    eventTail = (eventTail + 1) & EVENT_MASK;
+    return true;
+}
+
+/** The state of the ball from the last COMMUNICATION_BALL event. The ball is only passed to this funkit again once it has sent it back, so
+    there is at most one each update.
+ * @return The recieved ball, valid until the next update.
+*/
+const CommunicationBall_t* communication_ball(void)
+{
+    return &ball;
+}
@@ -7,39 +7,78 @@
 #define COMMUNICATION_H
 
 #include "system.h"
+#include "input.h"
 
-/* Holds all infomation that may be transmitted over ir. */
+/* Kinds of event recieved from the other funkits, see CommunicationEvent_t. */
+typedef enum {
+    COMMUNICATION_START_GAME,
+    COMMUNICATION_BALL,
+    COMMUNICATION_END_ROUND,
+    COMMUNICATION_GAME_OVER
+} CommunicationEventType_t;
+
+/* An event recieved from the other funkits, packed in to a byte. haveBall is set on a game start if this board starts with the ball. On a
+    relay board fromBack tells which side the ball or end of round came from. The state of a ball is read with communication_ball. */
+typedef struct {
+    uint8_t type : 2;
+    bool haveBall : 1;
+    bool fromBack : 1;
+} CommunicationEvent_t;
+
+/* The state of the ball recieved with a COMMUNICATION_BALL event. hopFrames is the time the ball took to cross from the other funkit,
+    from the frames the other funkit held it for and the link latency, and once the shared frames are in step the frame it was sent on. */
 typedef struct {
-    bool startGame;
-    bool haveBall;
-    bool endRound;
-    bool gameOver;
-    bool physicsInfo;
-    uint8_t posR;
-    bool dirR;
-    uint8_t magC;
-} CommunicationPacket_t;
-
-/** Initializes communication, calling API functions to initialize the led and ir, and setting the initial state. */
+    int16_t ballPosR;
+    int8_t ballVelR;
+    int8_t ballVelC;
+    uint8_t hopFrames;
+} CommunicationBall_t;
+
+/** Initializes communication, calling API functions to initialize the led and ir, and setting the initial state. Relay boards (see geometry.h)
+    can't start the game, they join it when a start code reaches them and pass it on, and pass on every end of round. */
 void communication_init(void);
 
-/** Ends the current round. */
+/** Ends the current round, the end is queued on the link for the other funkit by communication_update once the window has room. */
 void communication_send_end_round(void);
 
-/** Ends the game. */
+/** Ends the game, the end is queued on the link for the other funkit by communication_update once the window has room. */
 void communication_send_end_game(void);
 
-/** Sets the physics packet to be sent over ir, and sets the state to sending.
- * @param posR The row posistion of the ball.
- * @param dirR Whether the ball is moving positively in the row direction.
- * @param magC The magnitude of the velocity in the column direction.
+/** Ends the round or the game without telling the other funkit, for lockstep play where both funkits know when the round ends.
+ * @param gameOver True if the game has ended, otherwise the next round can be started.
+*/
+void communication_finish_round(bool gameOver);
+
+/** Queues the ball's state to be sent over ir, and sets the state to recieving. Does nothing unless the state is waiting, which it stays in if
+ * the link's window is full, so the game calls this every frame the ball is off the board.
+ * @param ballPosR The row posistion of the ball in subpixels.
+ * @param ballVelR The velocity of the ball in the row direction.
+ * @param ballVelC The velocity of the ball in the column direction.
+ * @param toBack True if the ball left over the back edge of this relay board, otherwise it left over column 0.
 */
-void communication_send_physics_info(uint8_t posR, bool dirR, uint8_t magC);
+void communication_send_physics_info(int16_t ballPosR, int8_t ballVelR, int8_t ballVelC, bool toBack);
+
+/** Checks if communication has nothing to send until a byte is recieved or the navswitch is pushed, so frames can be slept through.
+ * @return True if waiting for the game to start, or the game is over, with nothing left to send.
+*/
+bool communication_idle_p(void);
 
 /**
- * The communication state machine, updates state based on current state and recieved data from ir, and returns any data recieved.
- * @return A communication packet that can be checked for any flags or infomation recieved.
+ * The communication state machine, updates state based on current state and recieved data from ir, queueing any events recieved.
+ * @param input The input for this frame, a push starts the game.
+*/
+void communication_update(Input_t input);
+
+/** Takes the oldest event queued by communication_update, every event should be taken before the next update.
+ * @param event Filled in with the event.
+ * @return False if there are no more events.
+*/
+bool communication_next_event(CommunicationEvent_t* event);
+
+/** The state of the ball from the last COMMUNICATION_BALL event. The ball is only passed to this funkit again once it has sent it back, so
+    there is at most one each update.
+ * @return The recieved ball, valid until the next update.
 */
-CommunicationPacket_t communication_update(void);
+const CommunicationBall_t* communication_ball(void);
 
 #endif //COMMUNICATION_H
\ No newline at end of file
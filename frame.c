@@ -0,0 +1,144 @@
+/** @file frame.c
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Framing of multi-byte packets sent over the ir channel, protected by a CRC-16.
+*/
+
+#include "frame.h"
+
+#define CRC16_POLYNOMIAL 0x1021
+
+/* Decoder states. */
+enum {
+    DECODE_IDLE,
+    DECODE_LENGTH,
+    DECODE_PAYLOAD,
+    DECODE_CRC_HIGH,
+    DECODE_CRC_LOW
+};
+
+/** Updates a CRC-16 (CCITT polynomial 0x1021) with a byte.
+ * @param crc The current crc value, FRAME_CRC_INIT for a new crc.
+ * @param data The byte to add to the crc.
+ * @return The updated crc.
+*/
+uint16_t frame_crc16(uint16_t crc, uint8_t data)
+{
+    crc ^= (uint16_t)data << 8;
+    for(uint8_t i = 0; i < 8; i++) {
+        crc = (crc & 0x8000) ? (crc << 1) ^ CRC16_POLYNOMIAL : crc << 1;
+    }
+    return crc;
+}
+
+/** Writes a byte of a frame, escaping it if it could be mistaken for a code.
+ * @param buffer Where to write the byte.
+ * @param data The byte to write.
+ * @return The number of bytes written.
+*/
+static uint8_t frame_put(uint8_t* buffer, uint8_t data)
+{
+    if(data >= FRAME_START_CODE) {
+        buffer[0] = FRAME_ESCAPE_CODE;
+        buffer[1] = data - FRAME_ESCAPE_OFFSET;
+        return 2;
+    }
+    buffer[0] = data;
+    return 1;
+}
+
+/** Builds a frame around a payload.
+ * @param buffer Where to write the frame, must hold at least FRAME_MAX_LENGTH bytes.
+ * @param payload The payload bytes.
+ * @param length The number of payload bytes, at most FRAME_MAX_PAYLOAD.
+ * @return The total number of bytes written to buffer.
+*/
+uint8_t frame_encode(uint8_t* buffer, const uint8_t* payload, uint8_t length)
+{
+    uint16_t crc = frame_crc16(FRAME_CRC_INIT, length);
+    uint8_t size = 0;
+    buffer[size++] = FRAME_START_CODE;
+    buffer[size++] = length;
+    for(uint8_t i = 0; i < length; i++) {
+        size += frame_put(&buffer[size], payload[i]);
+        crc = frame_crc16(crc, payload[i]);
+    }
+    size += frame_put(&buffer[size], crc >> 8);
+    size += frame_put(&buffer[size], crc & 0xFF);
+    return size;
+}
+
+/** Resets a decoder so it waits for the start of a new frame.
+ * @param decoder The decoder to reset.
+*/
+void frame_decoder_init(FrameDecoder_t* decoder)
+{
+    decoder->state = DECODE_IDLE;
+    decoder->escaped = false;
+    decoder->length = 0;
+    decoder->index = 0;
+    decoder->crc = FRAME_CRC_INIT;
+}
+
+/** Passes a recieved byte to the decoder.
+ * @param decoder The decoder.
+ * @param data The recieved byte.
+ * @return FRAME_BYTE if the byte is a code outside of a frame, FRAME_COMPLETE if the byte finished a frame with a valid crc (the payload is
+ *  then in decoder->payload and its length in decoder->length), otherwise FRAME_NONE.
+*/
+FrameResult_t frame_decode(FrameDecoder_t* decoder, uint8_t data)
+{
+    if(data == FRAME_START_CODE) {
+        /* Always start a new frame, abandoning any frame that was cut short. */
+        frame_decoder_init(decoder);
+        decoder->state = DECODE_LENGTH;
+        return FRAME_NONE;
+    }
+
+    if(decoder->state == DECODE_IDLE) {
+        return data == FRAME_ESCAPE_CODE ? FRAME_NONE : FRAME_BYTE;
+    }
+
+    if(data == FRAME_ESCAPE_CODE && !decoder->escaped) {
+        decoder->escaped = true;
+        return FRAME_NONE;
+    }
+    if(data > FRAME_ESCAPE_CODE) {
+        /* A code can't be part of a frame, so the frame was interrupted and the code is handled on its own. */
+        frame_decoder_init(decoder);
+        return FRAME_BYTE;
+    }
+    if(decoder->escaped) {
+        data += FRAME_ESCAPE_OFFSET;
+        decoder->escaped = false;
+    }
+
+    switch (decoder->state) {
+        case DECODE_LENGTH:
+            /* A length that can't be valid means this wasn't a real frame, so resynchronise. */
+            if(data > FRAME_MAX_PAYLOAD) {
+                decoder->state = DECODE_IDLE;
+                break;
+            }
+            decoder->length = data;
+            decoder->crc = frame_crc16(FRAME_CRC_INIT, data);
+            decoder->state = data > 0 ? DECODE_PAYLOAD : DECODE_CRC_HIGH;
+            break;
+        case DECODE_PAYLOAD:
+            decoder->payload[decoder->index++] = data;
+            decoder->crc = frame_crc16(decoder->crc, data);
+            if(decoder->index == decoder->length) {
+                decoder->state = DECODE_CRC_HIGH;
+            }
+            break;
+        case DECODE_CRC_HIGH:
+            decoder->state = data == (decoder->crc >> 8) ? DECODE_CRC_LOW : DECODE_IDLE;
+            break;
+        case DECODE_CRC_LOW:
+            decoder->state = DECODE_IDLE;
+            if(data == (decoder->crc & 0xFF)) {
+                return FRAME_COMPLETE;
+            }
+            break;
+    }
+    return FRAME_NONE;
+}
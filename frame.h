@@ -0,0 +1,70 @@
+/** @file frame.h
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Framing of multi-byte packets sent over the ir channel, protected by a CRC-16.
+*/
+
+#ifndef FRAME_H
+#define FRAME_H
+
+#include "system.h"
+
+/* Frame layout: FRAME_START_CODE, payload length, payload bytes, CRC-16 of the length and payload (high byte first). Bytes recieved outside of a frame
+    are passed through unchanged, so the single byte codes used by the communication state machine can be mixed with frames.
+    All codes are at or above FRAME_START_CODE, so any payload or crc byte in that range is sent as FRAME_ESCAPE_CODE followed by the
+    byte minus FRAME_ESCAPE_OFFSET. This means a frame whose start code was lost can never be mistaken for codes, and a code
+    recieved part way through a frame is known to have interrupted it. A lost length byte makes the decoder read the frame from the wrong
+    bytes, which a CRC-8 lets through one time in 256, so a 16 bit crc is used to keep corrupt frames from reaching the link. */
+#define FRAME_START_CODE 0xC5
+#define FRAME_ESCAPE_CODE 0xC6
+#define FRAME_ESCAPE_OFFSET 0x80
+#define FRAME_MAX_PAYLOAD 8
+#define FRAME_CRC_INIT 0xFFFF
+/* The longest a frame can be once encoded, if every payload and crc byte is escaped. */
+#define FRAME_MAX_LENGTH (2 + 2 * (FRAME_MAX_PAYLOAD + 2))
+
+/* The result of passing a recieved byte to the frame decoder. */
+typedef enum {
+    FRAME_NONE,
+    FRAME_BYTE,
+    FRAME_COMPLETE
+} FrameResult_t;
+
+/* Holds the decoding progress of a frame being recieved. */
+typedef struct {
+    uint8_t state;
+    bool escaped;
+    uint8_t length;
+    uint8_t index;
+    uint16_t crc;
+    uint8_t payload[FRAME_MAX_PAYLOAD];
+} FrameDecoder_t;
+
+/** Updates a CRC-16 (CCITT polynomial 0x1021) with a byte.
+ * @param crc The current crc value, FRAME_CRC_INIT for a new crc.
+ * @param data The byte to add to the crc.
+ * @return The updated crc.
+*/
+uint16_t frame_crc16(uint16_t crc, uint8_t data);
+
+/** Builds a frame around a payload.
+ * @param buffer Where to write the frame, must hold at least FRAME_MAX_LENGTH bytes.
+ * @param payload The payload bytes.
+ * @param length The number of payload bytes, at most FRAME_MAX_PAYLOAD.
+ * @return The total number of bytes written to buffer.
+*/
+uint8_t frame_encode(uint8_t* buffer, const uint8_t* payload, uint8_t length);
+
+/** Resets a decoder so it waits for the start of a new frame.
+ * @param decoder The decoder to reset.
+*/
+void frame_decoder_init(FrameDecoder_t* decoder);
+
+/** Passes a recieved byte to the decoder.
+ * @param decoder The decoder.
+ * @param data The recieved byte.
+ * @return FRAME_BYTE if the byte is a code outside of a frame, FRAME_COMPLETE if the byte finished a frame with a valid crc (the payload is
+ *  then in decoder->payload and its length in decoder->length), otherwise FRAME_NONE.
+*/
+FrameResult_t frame_decode(FrameDecoder_t* decoder, uint8_t data);
+
+#endif //FRAME_H
\ No newline at end of file
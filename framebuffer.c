@@ -0,0 +1,125 @@
+/** @file framebuffer.c
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Double buffered display with per column dirty tracking, so only columns that change are redrawn each frame.
+*/
+
+#include "framebuffer.h"
+
+#define ALL_COLUMNS (BIT(FRAMEBUFFER_NUM_COLS) - 1)
+/* The index of a column's bitmask in a plane of a buffer, the buffers are laid out plane by plane as ledscan expects. */
+#define INDEX(plane, col) ((plane) * FRAMEBUFFER_NUM_COLS + (col))
+
+static uint8_t buffers[2][LEDSCAN_NUM_PLANES * FRAMEBUFFER_NUM_COLS];
+/* The buffer shown by ledscan, and the one being drawn. */
+static uint8_t* front = buffers[0];
+static uint8_t* back = buffers[1];
+/* Bit n is set if column n needs to be redrawn. */
+static uint8_t dirtyColumns = 0;
+
+/** Initializes both buffers blank, shows the front buffer and marks every column dirty. */
+void framebuffer_init(void)
+{
+    for(uint8_t i = 0; i < LEDSCAN_NUM_PLANES * FRAMEBUFFER_NUM_COLS; i++) {
+        buffers[0][i] = 0x00;
+        buffers[1][i] = 0x00;
+    }
+    front = buffers[0];
+    back = buffers[1];
+    dirtyColumns = ALL_COLUMNS;
+    ledscan_show(front);
+}
+
+/** Marks a column as needing to be redrawn this frame.
+ * @param col The column.
+*/
+void framebuffer_invalidate(uint8_t col)
+{
+    dirtyColumns |= BIT(col);
+}
+
+/** Marks every column as needing to be redrawn this frame. */
+void framebuffer_invalidate_all(void)
+{
+    dirtyColumns = ALL_COLUMNS;
+}
+
+/** Checks if a column needs to be redrawn this frame.
+ * @param col The column.
+ * @return True if the column is dirty.
+*/
+bool framebuffer_dirty_p(uint8_t col)
+{
+    return (dirtyColumns & BIT(col)) != 0;
+}
+
+/** Draws a dirty column in the back buffer, with the lit rows at full brightness.
+ * @param col The column.
+ * @param pattern The bitmask of lit rows.
+*/
+void framebuffer_draw_column(uint8_t col, uint8_t pattern)
+{
+    for(uint8_t plane = 0; plane < LEDSCAN_NUM_PLANES; plane++) {
+        back[INDEX(plane, col)] = pattern;
+    }
+}
+
+/** Changes the brightness of one led in a column drawn this frame.
+ * @param col The column.
+ * @param row The row.
+ * @param level The brightness, from 0 (off) to FRAMEBUFFER_MAX_LEVEL.
+*/
+void framebuffer_draw_led(uint8_t col, uint8_t row, uint8_t level)
+{
+    /* Bit n of the level is the led's bit in plane n. */
+    for(uint8_t plane = 0; plane < LEDSCAN_NUM_PLANES; plane++) {
+        if(level & BIT(plane)) {
+            back[INDEX(plane, col)] |= BIT(row);
+        } else {
+            back[INDEX(plane, col)] &= ~BIT(row);
+        }
+    }
+}
+
+/** Checks if a column differs between the back and front buffers.
+ * @param col The column.
+ * @return True if any plane of the column differs.
+*/
+static bool column_changed_p(uint8_t col)
+{
+    for(uint8_t plane = 0; plane < LEDSCAN_NUM_PLANES; plane++) {
+        if(back[INDEX(plane, col)] != front[INDEX(plane, col)]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Shows the back buffer if any column changed, then brings the new back buffer up to date and clears the dirty columns. */
+void framebuffer_present(void)
+{
+    /* A column redrawn with the same pattern hasn't really changed. */
+    uint8_t changed = 0;
+    for(uint8_t col = 0; col < FRAMEBUFFER_NUM_COLS; col++) {
+        if((dirtyColumns & BIT(col)) && column_changed_p(col)) {
+            changed |= BIT(col);
+        }
+    }
+    dirtyColumns = 0;
+    if(changed == 0) {
+        return;
+    }
+
+    uint8_t* drawn = back;
+    back = front;
+    front = drawn;
+    ledscan_show(front);
+
+    /* The new back buffer is a frame behind, only the changed columns need copying to bring it up to date. */
+    for(uint8_t col = 0; col < FRAMEBUFFER_NUM_COLS; col++) {
+        if(changed & BIT(col)) {
+            for(uint8_t plane = 0; plane < LEDSCAN_NUM_PLANES; plane++) {
+                back[INDEX(plane, col)] = front[INDEX(plane, col)];
+            }
+        }
+    }
+}
@@ -0,0 +1,49 @@
+/** @file framebuffer.h
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Double buffered display with per column dirty tracking, so only columns that change are redrawn each frame.
+*/
+
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include "system.h"
+#include "ledscan.h"
+
+#define FRAMEBUFFER_NUM_COLS LEDSCAN_NUM_COLS
+/* The brightest level a led can be drawn at, 0 is off. */
+#define FRAMEBUFFER_MAX_LEVEL LEDSCAN_MAX_LEVEL
+
+/** Initializes both buffers blank, shows the front buffer and marks every column dirty. */
+void framebuffer_init(void);
+
+/** Marks a column as needing to be redrawn this frame.
+ * @param col The column.
+*/
+void framebuffer_invalidate(uint8_t col);
+
+/** Marks every column as needing to be redrawn this frame. */
+void framebuffer_invalidate_all(void);
+
+/** Checks if a column needs to be redrawn this frame.
+ * @param col The column.
+ * @return True if the column is dirty.
+*/
+bool framebuffer_dirty_p(uint8_t col);
+
+/** Draws a dirty column in the back buffer, with the lit rows at full brightness.
+ * @param col The column.
+ * @param pattern The bitmask of lit rows.
+*/
+void framebuffer_draw_column(uint8_t col, uint8_t pattern);
+
+/** Changes the brightness of one led in a column drawn this frame.
+ * @param col The column.
+ * @param row The row.
+ * @param level The brightness, from 0 (off) to FRAMEBUFFER_MAX_LEVEL.
+*/
+void framebuffer_draw_led(uint8_t col, uint8_t row, uint8_t level);
+
+/** Shows the back buffer if any column changed, then brings the new back buffer up to date and clears the dirty columns. */
+void framebuffer_present(void);
+
+#endif //FRAMEBUFFER_H
\ No newline at end of file
@@ -4,21 +4,41 @@
  */
 
 #include "system.h"
-#include "ledmat.h"
-#include "pacer.h"
-#include "navswitch.h"
+#include "framebuffer.h"
+#include "idle.h"
+#include "timer.h"
+#include "input.h"
 #include "physics.h"
+#include "geometry.h"
 #include "communication.h"
-#include <stdlib.h>
+#include "link.h"
+#include "profile.h"
+#include "replay.h"
+#include "scheduler.h"
+#include <avr/pgmspace.h>
+#ifdef LOCKSTEP
+#include "lockstep.h"
+#endif
 
 /* Constants. */
 #define REFRESH_RATE 50
-#define NUM_COLS 5
-#define SCORE_FIRST_COL 3
+/* The pacer ticks this many times a frame, the tasks of each frame are spread over the slots between ticks. */
+#define SLOTS_PER_FRAME 4
+#define NUM_COLS FRAMEBUFFER_NUM_COLS
+/* Rows of the led matrix. */
+#define NUM_ROWS 7
 #define WINNING_SCORE 3
+/* The ball is drawn at BALL_STEPS posistions per led, blended over the leds either side of its posistion, see ball_blend. */
+#define BALL_STEP_SHIFT 3
+#define BALL_STEPS BIT(BALL_STEP_SHIFT)
 
-/* Bitmask for each column of the display. */
-uint8_t display[5] = {0x00, 0x00, 0x00, 0x00, 0x00};
+_Static_assert(GEOMETRY_COLS == NUM_COLS, "the court must fill the display");
+_Static_assert(GEOMETRY_ROWS <= NUM_ROWS, "the court doesn't fit the display");
+_Static_assert(WINNING_SCORE <= GEOMETRY_SCORE_MAX, "the score bars are too short for WINNING_SCORE");
+
+#if defined(LOCKSTEP) && (GEOMETRY_SEAM != 0 || GEOMETRY_RELAY)
+#error "lockstep play is only between two funkits"
+#endif
 
 typedef enum {
     GAME_START,
@@ -26,109 +46,421 @@ typedef enum {
     GAME_END
 } GameState_t;
 
-/** Entry point. */
-int main (void)
+/* Everything that is drawn on the display, compared between frames to find which columns need to be redrawn. */
+typedef struct {
+    GameState_t gameState;
+    uint8_t score;
+    uint8_t opponentScore;
+    int8_t paddleC;
+    int8_t paddleR;
+    bool ballShown;
+    /* The ball posistion in BALL_STEPS per led. */
+    PhysicsPos_t ballC;
+    PhysicsPos_t ballR;
+} Scene_t;
+
+/* The drawing is precomputed into tables in flash, so composing a column is a table read rather than a loop of shifts and compares. The tables
+    are written out for the display and the winning score, and are filled in from geometry.h by these macros. */
+_Static_assert(NUM_COLS == 5 && NUM_ROWS == 7 && WINNING_SCORE == 3 && BALL_STEPS == 8, "the drawing tables are written out for another size");
+
+/* Scores are drawn as bars running from GEOMETRY_SCORE_FIRST_COL towards column 0, ours near the bottom of the display and the other funkit's
+    near the top, and widened at the end of the game. */
+#define SCORE_BAR_P(score, col) ((col) <= GEOMETRY_SCORE_FIRST_COL && GEOMETRY_SCORE_FIRST_COL - (col) < (score))
+#define SCORE_COLUMN(wide, score, opponentScore, col) \
+    ((SCORE_BAR_P(score, col) ? BIT(GEOMETRY_SCORE_ROW) | ((wide) ? BIT(GEOMETRY_SCORE_WIDE_ROW) : 0) : 0) \
+    | (SCORE_BAR_P(opponentScore, col) ? BIT(GEOMETRY_OPPONENT_SCORE_ROW) | ((wide) ? BIT(GEOMETRY_OPPONENT_SCORE_WIDE_ROW) : 0) : 0))
+#define SCORE_SCREEN(wide, score, opponentScore) {SCORE_COLUMN(wide, score, opponentScore, 0), SCORE_COLUMN(wide, score, opponentScore, 1), \
+    SCORE_COLUMN(wide, score, opponentScore, 2), SCORE_COLUMN(wide, score, opponentScore, 3), SCORE_COLUMN(wide, score, opponentScore, 4)}
+#define SCORE_SCREENS(wide, score) {SCORE_SCREEN(wide, score, 0), SCORE_SCREEN(wide, score, 1), SCORE_SCREEN(wide, score, 2), \
+    SCORE_SCREEN(wide, score, 3)}
+#define SCORE_ALL_SCREENS(wide) {SCORE_SCREENS(wide, 0), SCORE_SCREENS(wide, 1), SCORE_SCREENS(wide, 2), SCORE_SCREENS(wide, 3)}
+
+/* The columns of the score screen for each score, indexed by whether the game is over, our score and the other funkit's score. */
+static const uint8_t scoreScreens[2][WINNING_SCORE + 1][WINNING_SCORE + 1][NUM_COLS] PROGMEM = {SCORE_ALL_SCREENS(0), SCORE_ALL_SCREENS(1)};
+
+/* The paddle column for each paddle row, the AVR has no barrel shifter so a shift by a variable is a loop. */
+#define PADDLE_COLUMN(r) ((uint8_t)(GEOMETRY_PADDLE_PATTERN << (r)))
+static const uint8_t paddleColumns[NUM_ROWS] PROGMEM = {
+    PADDLE_COLUMN(0), PADDLE_COLUMN(1), PADDLE_COLUMN(2), PADDLE_COLUMN(3), PADDLE_COLUMN(4), PADDLE_COLUMN(5), PADDLE_COLUMN(6)
+};
+
+/* The brightness of a led with weightC of the ball's columns and weightR of its rows on it, each out of BALL_STEPS, rounded to the nearest
+    level, see draw_ball. */
+#define BALL_LEVEL(weightC, weightR) (((weightC) * (weightR) * FRAMEBUFFER_MAX_LEVEL + BALL_STEPS * BALL_STEPS / 2) >> (2 * BALL_STEP_SHIFT))
+#define BALL_LEVELS(weightC) {BALL_LEVEL(weightC, 0), BALL_LEVEL(weightC, 1), BALL_LEVEL(weightC, 2), BALL_LEVEL(weightC, 3), \
+    BALL_LEVEL(weightC, 4), BALL_LEVEL(weightC, 5), BALL_LEVEL(weightC, 6), BALL_LEVEL(weightC, 7), BALL_LEVEL(weightC, 8)}
+static const uint8_t ballLevels[BALL_STEPS + 1][BALL_STEPS + 1] PROGMEM = {
+    BALL_LEVELS(0), BALL_LEVELS(1), BALL_LEVELS(2), BALL_LEVELS(3), BALL_LEVELS(4), BALL_LEVELS(5), BALL_LEVELS(6), BALL_LEVELS(7), BALL_LEVELS(8)
+};
+
+/** Builds the scene to draw from the game state.
+ * @param gameState The current game state.
+ * @param physicsState The current physics state.
+ * @param score Our score.
+ * @param opponentScore The other funkit's score.
+ * @return The scene.
+*/
+static Scene_t build_scene(GameState_t gameState, const PhysicsState_t* physicsState, uint8_t score, uint8_t opponentScore)
 {
-    /* Initialise all necessary api functions for operation.*/
-    system_init ();
-    navswitch_init ();
-    ledmat_init();
-    pacer_init(NUM_COLS * REFRESH_RATE);
+    /* The ball is kept whole on the court when it is against the side walls, it only fades out over the ends. */
+    PhysicsPos_t ballR = physicsState->ballPosR >> (PHYSICS_SUBPIXEL_SHIFT - BALL_STEP_SHIFT);
+    if(ballR < BALL_STEPS / 2) {
+        ballR = BALL_STEPS / 2;
+    } else if(ballR > GEOMETRY_ROWS * BALL_STEPS - BALL_STEPS / 2) {
+        ballR = GEOMETRY_ROWS * BALL_STEPS - BALL_STEPS / 2;
+    }
 
-    /* Initialise game state, communication module and physics state. */
-    GameState_t gameState = GAME_START;
-    communication_init();
-    PhysicsState_t physicsState = physics_init(false);
+    Scene_t scene = {
+        .gameState = gameState,
+        .score = score,
+        .opponentScore = opponentScore,
+        .paddleC = physicsState->paddleC,
+        .paddleR = physicsState->paddleR,
+        .ballShown = gameState == GAME_ACTIVE && physicsState->ballActive,
+        .ballC = physicsState->ballPosC >> (PHYSICS_SUBPIXEL_SHIFT - BALL_STEP_SHIFT),
+        .ballR = ballR
+    };
+    return scene;
+}
 
-    uint8_t opponentScore = 0;
-    uint8_t score = 0;
+/** Finds the two leds either side of a ball posistion, a ball in the middle of a led is drawn only on that led.
+ * @param steps The ball posistion along a row or column, in BALL_STEPS per led.
+ * @param weight Set to how much of the ball is on the second led, out of BALL_STEPS, the first led has the rest.
+ * @return The first led, -1 if the ball is over the first half of led 0.
+*/
+static int8_t ball_blend(PhysicsPos_t steps, uint8_t* weight)
+{
+    steps += BALL_STEPS / 2;
+    *weight = steps & (BALL_STEPS - 1);
+    return (steps >> BALL_STEP_SHIFT) - 1;
+}
 
-    uint8_t column = 0;
-    while (1)
-    {
-        pacer_wait();
+/** Marks the columns a scene's ball is drawn on as dirty.
+ * @param scene The scene.
+*/
+static void invalidate_ball(const Scene_t* scene)
+{
+    uint8_t weight;
+    int8_t first = ball_blend(scene->ballC, &weight);
+    for(int8_t col = first; col <= first + 1; col++) {
+        if(col >= 0 && col < NUM_COLS) {
+            framebuffer_invalidate(col);
+        }
+    }
+}
 
-        /* Each column is refreshed sequentially at 250Hz, game update is 50Hz. */
-        if(column == 0) {
-            /* Reset display. */
-            for(uint8_t col=0; col<NUM_COLS; col++) {
-                display[col] = 0x00;
-            }
+/** Marks the columns that differ between two scenes as dirty.
+ * @param last The scene drawn last frame.
+ * @param scene The scene to draw this frame.
+*/
+static void invalidate_scene(const Scene_t* last, const Scene_t* scene)
+{
+    /* Changing between the score and the game redraws everything, as does a change of score. */
+    if(last->gameState != scene->gameState || last->score != scene->score || last->opponentScore != scene->opponentScore) {
+        framebuffer_invalidate_all();
+        return;
+    }
+    if(scene->gameState != GAME_ACTIVE) {
+        return;
+    }
+    if(last->paddleC != scene->paddleC || last->paddleR != scene->paddleR) {
+        framebuffer_invalidate(last->paddleC);
+        framebuffer_invalidate(scene->paddleC);
+    }
+    if(last->ballShown != scene->ballShown || last->ballC != scene->ballC || last->ballR != scene->ballR) {
+        if(last->ballShown) {
+            invalidate_ball(last);
+        }
+        if(scene->ballShown) {
+            invalidate_ball(scene);
+        }
+    }
+}
+
+/** Composes one column of the display from the scene.
+ * Displays the score if GAME_START or GAME_END, double width if GAME_END, or the paddle if GAME_ACTIVE, the ball is drawn over it by draw_ball.
+ * @param scene The scene to draw.
+ * @param col The column.
+ * @return The bitmask of rows lit at full brightness in the column.
+*/
+static uint8_t compose_column(const Scene_t* scene, uint8_t col)
+{
+    if(scene->gameState == GAME_START || scene->gameState == GAME_END) {
+        return pgm_read_byte(&scoreScreens[scene->gameState == GAME_END][scene->score][scene->opponentScore][col]);
+    }
+
+    if(!GEOMETRY_RELAY && col == scene->paddleC) {
+        return pgm_read_byte(&paddleColumns[scene->paddleR]);
+    }
+    return 0x00;
+}
+
+/** Draws the part of the ball in a column, each of the up to four leds around the ball is lit in proportion to how much of the ball is on it,
+ * so the ball moves smoothly between leds rather than jumping.
+ * @param scene The scene to draw.
+ * @param col The column, already drawn with compose_column.
+ * @param pattern The rows already lit in the column, which are left at full brightness.
+*/
+static void draw_ball(const Scene_t* scene, uint8_t col, uint8_t pattern)
+{
+    if(!scene->ballShown) {
+        return;
+    }
 
-            /* Check for recieved data from the other funkit, and respond accordingly. */
-            CommunicationPacket_t packet = communication_update();
-            if(packet.startGame) {
+    uint8_t weightC;
+    int8_t firstC = ball_blend(scene->ballC, &weightC);
+    if(col == firstC) {
+        weightC = BALL_STEPS - weightC;
+    } else if(col != firstC + 1) {
+        return;
+    }
+
+    uint8_t weightR;
+    int8_t firstR = ball_blend(scene->ballR, &weightR);
+    for(int8_t row = firstR; row <= firstR + 1; row++) {
+        uint8_t rowWeight = row == firstR ? BALL_STEPS - weightR : weightR;
+        if(row < 0 || row >= GEOMETRY_ROWS || (pattern & BIT(row))) {
+            continue;
+        }
+        uint8_t level = pgm_read_byte(&ballLevels[weightC][rowWeight]);
+        if(level > 0) {
+            framebuffer_draw_led(col, row, level);
+        }
+    }
+}
+
+/* The game, shared by the tasks below. */
+static GameState_t gameState = GAME_START;
+static PhysicsState_t physicsState;
+static uint8_t score = 0;
+static uint8_t opponentScore = 0;
+#ifdef LOCKSTEP
+/* Our player number in the lockstep simulation, 0 if we started the round with the ball. */
+static uint8_t player = 0;
+#else
+/* The time of the last frame, physics runs the ticks due in the time since then. Lockstep physics runs a fixed time step per frame instead. */
+static timer_tick_t lastFrame;
+/* The shared frame (see link_frame) at the last frame. */
+static uint8_t lastSharedFrame;
+#endif
+/* The input scanned this frame by game_task, also checked for a profile dump by upkeep_task. */
+static Input_t input;
+/* The scene last drawn. */
+static Scene_t lastScene;
+/* Whether the slots until there is input or ir data can be slept through, set at the end of each frame. */
+static bool quiet = false;
+
+/** Scans the input, handles everything recieved from the other funkits and runs the physics for the frame. */
+static void game_task(void)
+{
+    timer_tick_t now = timer_get();
+#ifndef LOCKSTEP
+    uint16_t elapsed = now - lastFrame;
+    lastFrame = now;
+#endif
+
+    /* Each stage is timed from the end of the last, see profile.h. */
+    timer_tick_t stageStart = now;
+
+    /* The navswitch is scanned once per frame, and the same snapshot is given to communication and physics. */
+    input = input_update();
+#ifdef AI_PADDLE
+    /* The paddle is moved by the physics ai, the navswitch still starts rounds and dumps the profile, see physics_ai_input. */
+    Input_t ai = physics_ai_input(&physicsState);
+    input.north = ai.north;
+    input.south = ai.south;
+    input.west = ai.west;
+#endif
+
+    /* Check for recieved data from the other funkit, and respond to each event in the order it arrived. */
+    communication_update(input);
+#ifndef LOCKSTEP
+    /* The shared frame counter moves on a frame each frame, and is stepped to keep in step with the other funkits. The physics runs those
+        steps too, so the ball keeps the same pace on a funkit whose timer runs fast or slow as on the others. While the counter is first
+        brought in step it can jump, so at most a frame either way is taken. */
+    uint8_t sharedFrame = link_frame();
+    int8_t step = (int8_t)(sharedFrame - lastSharedFrame - 1);
+    lastSharedFrame = sharedFrame;
+    if(link_frame_synced_p() && step > 0) {
+        elapsed += TIMER_RATE / REFRESH_RATE;
+    } else if(link_frame_synced_p() && step < 0) {
+        elapsed = elapsed > TIMER_RATE / REFRESH_RATE ? elapsed - TIMER_RATE / REFRESH_RATE : 0;
+    }
+#endif
+    CommunicationEvent_t event;
+    while(communication_next_event(&event)) {
+#ifndef LOCKSTEP
+        /* The match is recorded to eeprom so it can be played back on a pc, see replay.h. Lockstep play isn't recorded. */
+        replay_record_event(event, communication_ball());
+#endif
+        switch ((CommunicationEventType_t)event.type) {
+            case COMMUNICATION_START_GAME:
                 gameState = GAME_ACTIVE;
-                physicsState = physics_init(packet.haveBall);
-            } else if(packet.physicsInfo) {
-                /* Ball transfers on to this boards display, update ball state accordingly. */
-                physicsState.ballActive = true;
-                physicsState.ballPosR = packet.posR * PHYSICS_SUBPIXEL+PHYSICS_SUBPIXEL / 2;
-                physicsState.ballPosC = 0;
-                physicsState.ballVelR = packet.dirR ? abs(physicsState.ballVelR) : -abs(physicsState.ballVelR);
-                physicsState.ballVelC = packet.magC;
-            } else if(packet.endRound) {
-                /* Recieved end round signal so update our score. */
+#ifdef LOCKSTEP
+                player = event.haveBall ? 0 : 1;
+                lockstep_init(player, score + opponentScore, TIMER_RATE / REFRESH_RATE);
+                physicsState = lockstep_player_state(player);
+#else
+                physicsState = physics_init(event.haveBall);
+                /* The time waiting on the score screen, which may have been slept through, isn't played. */
+                elapsed = 0;
+#endif
+                break;
+            case COMMUNICATION_BALL: {
+                /* Ball transfers on to this boards display, moved on by the time it took to cross so it keeps its speed over the seam. */
+                const CommunicationBall_t* ball = communication_ball();
+                physicsState = physics_receive_ball(physicsState, ball->ballPosR, ball->ballVelR, ball->ballVelC, event.fromBack,
+                    ball->hopFrames * (TIMER_RATE / REFRESH_RATE));
+                break;
+            }
+            case COMMUNICATION_END_ROUND:
+                /* Recieved end round signal so update our score. A relay counts the score of the player behind as its own. */
                 physicsState.gameOver = true;
-                score++;
+                if(event.fromBack) {
+                    opponentScore++;
+                } else {
+                    score++;
+                }
                 gameState = GAME_START;
-            } else if(packet.gameOver) {
+                break;
+            case COMMUNICATION_GAME_OVER:
                 /* Only update score if this is the first reception of the game over signal over ir. */
                 if(score != WINNING_SCORE && opponentScore != WINNING_SCORE) {
-                    score++;
-                }
-                gameState = GAME_END;
-            }
-
-            /* Display score if GAME_START or GAME_END, double width if GAME_END. 
-                Update physics and display ball and paddle if GAME_ACTIVE. */
-            if(gameState == GAME_START || gameState == GAME_END) {
-                for(uint8_t col = SCORE_FIRST_COL; col > SCORE_FIRST_COL - score; col--) {
-                    display[col] |= BIT(5);
-                    if(gameState == GAME_END) {
-                        display[col] |= BIT(4);
-                    }
-                }
-                for(uint8_t col = SCORE_FIRST_COL; col > SCORE_FIRST_COL - opponentScore; col--) {
-                    display[col] |= BIT(1);
-                    if(gameState == GAME_END) {
-                        display[col] |= BIT(2);
-                    }
-                }
-            } else if(gameState == GAME_ACTIVE) {
-                physicsState = physics_update(physicsState);
-
-                /* If game over flag is true then the ball went out on this board, so increase opponent score and send the relevant end message over ir. */
-                if(physicsState.gameOver) {
-                    gameState = GAME_START;
-                    opponentScore++;
-                    if(opponentScore == WINNING_SCORE) {
-                        gameState = GAME_END;
-                        communication_send_end_game();
+                    if(event.fromBack) {
+                        opponentScore++;
                     } else {
-                        communication_send_end_round();
+                        score++;
                     }
                 }
+                gameState = GAME_END;
+                break;
+        }
+    }
+    stageStart = profile_record(PROFILE_COMMUNICATION, stageStart);
 
-                /* Display paddle. */
-                display[physicsState.paddleC] |= BIT(physicsState.paddleR);
-                display[physicsState.paddleC] |= BIT(physicsState.paddleR + 1);
+#ifdef LOCKSTEP
+    /* Both funkits simulate the whole court from both inputs, see lockstep.h. The round ends on the same lockstep frame on both, so no
+        end messages are sent, but only once that frame is confirmed as a predicted loss may be rolled back. Inputs are still sent once
+        the round has ended, as the other funkit may not have reached that frame yet. */
+    if(gameState == GAME_ACTIVE && lockstep_update(input)) {
+        physicsState = lockstep_player_state(player);
+    }
+    if(gameState == GAME_ACTIVE) {
+        bool lost = lockstep_confirmed_state(player).gameOver;
+        bool opponentLost = lockstep_confirmed_state(!player).gameOver;
+        if(lost || opponentLost) {
+            if(lost) {
+                opponentScore++;
+            } else {
+                score++;
+            }
+            gameState = score == WINNING_SCORE || opponentScore == WINNING_SCORE ? GAME_END : GAME_START;
+            communication_finish_round(gameState == GAME_END);
+        }
+    }
+    lockstep_transmit();
+#else
+    /* Update physics if GAME_ACTIVE. */
+    if(gameState == GAME_ACTIVE) {
+        replay_record_frame(input, elapsed);
+        physicsState = physics_update(physicsState, input, elapsed);
 
-                /* Display ball or send ball transfer over ir. */
-                if(physicsState.ballActive) {
-                    display[physicsState.ballPosC / PHYSICS_SUBPIXEL] |= BIT(physicsState.ballPosR / PHYSICS_SUBPIXEL);
-                } else{
-                    /* This function only uses this info if it is the first time it was called per ball transfer (checks if WAITING or SENDING). */
-                    communication_send_physics_info(physicsState.ballPosR / PHYSICS_SUBPIXEL, physicsState.ballVelR >= 0, abs(physicsState.ballVelC));
-                }
+        /* If game over flag is true then the ball went out on this board, so increase opponent score and send the relevant end message over ir. */
+        if(physicsState.gameOver) {
+            gameState = GAME_START;
+            opponentScore++;
+            if(opponentScore == WINNING_SCORE) {
+                gameState = GAME_END;
+                communication_send_end_game();
+            } else {
+                communication_send_end_round();
             }
         }
-        
-        ledmat_display_column(display[column], column);
-        column = (column + 1) % NUM_COLS;
+
+        /* Send ball transfer over ir if the ball has left this board. */
+        if(!physicsState.ballActive) {
+            /* This function only uses this info if it is the first time it was called per ball transfer (checks if WAITING). */
+            communication_send_physics_info(physicsState.ballPosR, physicsState.ballVelR, physicsState.ballVelC, physicsState.ballExitBack);
+        }
     }
+#endif
+    stageStart = profile_record(PROFILE_PHYSICS, stageStart);
+}
 
+/** Redraws the columns of the display that changed since the last frame. */
+static void render_task(void)
+{
+    timer_tick_t start = timer_get();
+
+    /* The display is refreshed by the ledscan interrupt, only the columns whose contents changed since the last frame are redrawn. */
+    Scene_t scene = build_scene(gameState, &physicsState, score, opponentScore);
+    invalidate_scene(&lastScene, &scene);
     for(uint8_t col = 0; col < NUM_COLS; col++) {
-        ledmat_display_column(0x00, column);
+        if(framebuffer_dirty_p(col)) {
+            uint8_t pattern = compose_column(&scene, col);
+            framebuffer_draw_column(col, pattern);
+            draw_ball(&scene, col, pattern);
+        }
+    }
+    framebuffer_present();
+    lastScene = scene;
+    profile_record(PROFILE_DISPLAY, start);
+}
+
+/** Sends the profile dump and match record a little more each frame, and decides whether the next slots can be slept through. */
+static void upkeep_task(void)
+{
+    /* Pushing east on the score screen dumps the profile over ir, it is sent as the transmit buffer allows. */
+    if(input.east && gameState != GAME_ACTIVE) {
+        profile_dump();
+    }
+    profile_transmit();
+    replay_update();
+
+#ifndef LOCKSTEP
+    /* On the score screen the display only changes with a push or a message, so once nothing is left to send and the match record is
+        written the slots in between are slept through. Lockstep keeps sending inputs after the round, so it runs every frame. */
+    quiet = gameState != GAME_ACTIVE && communication_idle_p() && !profile_dumping_p() && !replay_writing_p();
+#endif
+}
+
+/* The tasks of each frame, in their own slots so no slot carries the whole frame, see scheduler.h. The display is drawn the slot after
+    the physics runs, and the physics runs a frame after the last, as before. */
+static const SchedulerTask_t tasks[] PROGMEM = {
+    {.run = game_task, .period = SLOTS_PER_FRAME, .offset = 0},
+    {.run = render_task, .period = SLOTS_PER_FRAME, .offset = 1},
+    {.run = upkeep_task, .period = SLOTS_PER_FRAME, .offset = 2}
+};
+
+/** Entry point. */
+int main (void)
+{
+    /* Initialise all necessary api functions for operation.*/
+    system_init ();
+    input_init();
+    ledscan_init();
+    framebuffer_init();
+    idle_init(REFRESH_RATE * SLOTS_PER_FRAME);
+    profile_init(TIMER_RATE / (REFRESH_RATE * SLOTS_PER_FRAME));
+    replay_init();
+
+    /* Initialise communication module and physics state. */
+    communication_init();
+    physicsState = physics_init(false);
+
+    /* framebuffer_init has marked every column dirty so the first frame is drawn in full. */
+    lastScene = build_scene(gameState, &physicsState, score, opponentScore);
+#ifndef LOCKSTEP
+    lastFrame = timer_get();
+#endif
+    scheduler_init(tasks, sizeof(tasks) / sizeof(tasks[0]));
+
+    while (1)
+    {
+        idle_wait(quiet);
+        quiet = false;
+        timer_tick_t now = timer_get();
+        scheduler_run();
+        profile_record(PROFILE_FRAME, now);
     }
 }
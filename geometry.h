@@ -0,0 +1,75 @@
+/** @file geometry.h
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Dimensions of the court and speed of the ball, every edge, bound and layout in the physics and display is derived from these at compile time.
+*/
+
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+#include "system.h"
+
+/* Each can be overridden when building a variant, e.g. make GEOMETRY=-DGEOMETRY_BALL_SPEED=8, both funkits must be built with the same values.
+    The court on each funkit is measured in leds, the row direction runs across the display and the column direction from the boundary with
+    the other funkit (column 0) to the paddle at the back. */
+#ifndef GEOMETRY_ROWS
+#define GEOMETRY_ROWS 7
+#endif
+#ifndef GEOMETRY_COLS
+#define GEOMETRY_COLS 5
+#endif
+#ifndef GEOMETRY_PADDLE_LENGTH
+#define GEOMETRY_PADDLE_LENGTH 2
+#endif
+/* Ball speeds in hundredths of a led per physics tick, the speed it is served at and the fastest a forward push can make it. */
+#ifndef GEOMETRY_BALL_SPEED
+#define GEOMETRY_BALL_SPEED 5
+#endif
+#ifndef GEOMETRY_BALL_MAX_SPEED
+#define GEOMETRY_BALL_MAX_SPEED 7
+#endif
+
+/* Funkits can be chained into a longer court, with relay boards between the two players that the ball crosses without a paddle. The seams
+    between boards are numbered from 0 at the bottom player's column 0, every board is built with GEOMETRY_BOARDS set to the number of boards
+    and GEOMETRY_SEAM to the seam at its column 0, and relays with GEOMETRY_RELAY set, their back edge being the next seam. The default is the
+    two player court, both funkits at seam 0. Seam 0 joins two column 0s, so the ball is mirrored across it, every later seam joins a relay's
+    back edge to the next board's column 0. */
+#ifndef GEOMETRY_BOARDS
+#define GEOMETRY_BOARDS 2
+#endif
+#ifndef GEOMETRY_SEAM
+#define GEOMETRY_SEAM 0
+#endif
+#ifndef GEOMETRY_RELAY
+#define GEOMETRY_RELAY 0
+#endif
+/* The highest seam number, seams are sent in two bits of each link frame. */
+#define GEOMETRY_MAX_SEAM 3
+
+/* The paddle sits in the back column, and a forward push moves it one column forward. */
+#define GEOMETRY_PADDLE_COL (GEOMETRY_COLS - 1)
+#define GEOMETRY_PADDLE_FORWARD_COL (GEOMETRY_PADDLE_COL - 1)
+#define GEOMETRY_PADDLE_MAX_R (GEOMETRY_ROWS - GEOMETRY_PADDLE_LENGTH)
+#define GEOMETRY_PADDLE_INIT_R (GEOMETRY_PADDLE_MAX_R / 2)
+/* The rows lit by a paddle with its top in row 0. */
+#define GEOMETRY_PADDLE_PATTERN (BIT(GEOMETRY_PADDLE_LENGTH) - 1)
+#define GEOMETRY_BALL_INIT_R (GEOMETRY_ROWS / 2)
+
+/* Scores are drawn as bars running from GEOMETRY_SCORE_FIRST_COL towards column 0, ours near the bottom of the display and the other funkit's
+    near the top. At the end of the game each bar is widened by the row towards the middle. */
+#define GEOMETRY_SCORE_FIRST_COL (GEOMETRY_COLS - 2)
+#define GEOMETRY_SCORE_MAX (GEOMETRY_SCORE_FIRST_COL + 1)
+#define GEOMETRY_SCORE_ROW (GEOMETRY_ROWS - 2)
+#define GEOMETRY_SCORE_WIDE_ROW (GEOMETRY_SCORE_ROW - 1)
+#define GEOMETRY_OPPONENT_SCORE_ROW 1
+#define GEOMETRY_OPPONENT_SCORE_WIDE_ROW (GEOMETRY_OPPONENT_SCORE_ROW + 1)
+
+/* A column of the display is drawn as a byte with a bit per row. */
+_Static_assert(GEOMETRY_ROWS >= 4 && GEOMETRY_ROWS <= 8, "GEOMETRY_ROWS must fit a column pattern and both score bars");
+_Static_assert(GEOMETRY_COLS >= 3, "GEOMETRY_COLS must leave a column in front of the forward paddle");
+_Static_assert(GEOMETRY_PADDLE_LENGTH >= 1 && GEOMETRY_PADDLE_LENGTH < GEOMETRY_ROWS, "GEOMETRY_PADDLE_LENGTH must fit within the rows");
+_Static_assert(GEOMETRY_OPPONENT_SCORE_WIDE_ROW < GEOMETRY_SCORE_WIDE_ROW, "the score bars must not overlap");
+_Static_assert(GEOMETRY_BOARDS >= 2 && GEOMETRY_BOARDS <= GEOMETRY_MAX_SEAM + 2, "the court has too many seams");
+_Static_assert(GEOMETRY_SEAM >= 0 && GEOMETRY_SEAM + GEOMETRY_RELAY <= GEOMETRY_BOARDS - 2, "GEOMETRY_SEAM is outside the court");
+_Static_assert(GEOMETRY_BALL_SPEED > 0 && GEOMETRY_BALL_SPEED <= GEOMETRY_BALL_MAX_SPEED, "GEOMETRY_BALL_SPEED must be positive and at most the maximum");
+
+#endif //GEOMETRY_H
\ No newline at end of file
@@ -0,0 +1,24 @@
+/** @file eeprom.h
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Host stand in for the avr eeprom header, the eeprom is an array that is always ready to write.
+*/
+
+#ifndef EEPROM_H
+#define EEPROM_H
+
+#include <stdint.h>
+
+/* The last eeprom address of the ATmega32U2. */
+#define E2END 0x3FF
+
+/* The eeprom contents, see host/eeprom.c. */
+extern uint8_t host_eeprom[E2END + 1];
+
+/** Erases the eeprom, every byte reads 0xFF as erased eeprom does. */
+void host_eeprom_erase(void);
+
+#define eeprom_is_ready() 1
+#define eeprom_write_byte(address, value) (host_eeprom[(uintptr_t)(address)] = (value))
+#define eeprom_read_byte(address) (host_eeprom[(uintptr_t)(address)])
+
+#endif //EEPROM_H
\ No newline at end of file
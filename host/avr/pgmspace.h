@@ -0,0 +1,15 @@
+/** @file pgmspace.h
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Host stand in for the avr program memory header, tables are kept in ordinary memory on a pc.
+*/
+
+#ifndef PGMSPACE_H
+#define PGMSPACE_H
+
+#include <stdint.h>
+
+#define PROGMEM
+
+#define pgm_read_byte(address) (*(const uint8_t*)(address))
+
+#endif //PGMSPACE_H
\ No newline at end of file
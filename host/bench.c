@@ -0,0 +1,864 @@
+/** @file bench.c
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Host benchmark for the physics and communication modules. Times millions of physics ticks, plays the ai paddle, records a match and
+    plays it back through the physics, and plays scripted ball handoffs between two copies of the communication modules over a simulated ir
+    channel to count the frames each handoff takes and, with one board's timer running fast, how far apart the boards' shared frame counters
+    get, and between three copies making a court with a relay board in the middle to count the frames each hop over each seam takes.
+    Lockstep play is run over the same channel to count the frames the simulation waits for inputs and is rolled back, to check both
+    copies confirm the same game and end each round together, and that the ball crosses either way in the same time. Last the ir soak test
+    is run between two copies to measure the channel it reports. Results that show a regression are checked, and the benchmark exits with a
+    failure if any check fails.
+*/
+
+#include "system.h"
+#include "timer.h"
+#include "physics.h"
+#include "communication.h"
+#include "lockstep.h"
+#include "soak.h"
+#include "link.h"
+#include "channel.h"
+#include "host_ir.h"
+#include "replay.h"
+#include "replay_player.h"
+#include <avr/eeprom.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* The simulated frame rate, and bytes of airtime per second at the ir baud rate (8 data bits, a start and a stop bit). */
+#define FRAME_RATE 50
+#define IR_BAUD_RATE 2400
+#define IR_BYTES_PER_SECOND (IR_BAUD_RATE / 10)
+#define PHYSICS_PERIOD (TIMER_RATE / PHYSICS_RATE)
+
+#define PHYSICS_BENCH_TICKS 10000000UL
+/* Frames the ai paddle plays, every ball is sent back at a pseudo random angle and speed up to AI_BENCH_MAX_VEL subpixels per tick. */
+#define AI_BENCH_FRAMES 1000000UL
+#define AI_BENCH_MAX_VEL 9
+/* Each handoff is sent with its number as the ball's row, which the physics message holds in 10 bits. */
+#define HANDOFF_BENCH_COUNT 1000
+/* Frames the ball is held on a board before it is handed back, and the longest a handoff may take before the run is abandoned. */
+#define HOLD_FRAMES 10
+#define HANDOFF_TIMEOUT_FRAMES 1000
+#define LOCKSTEP_BENCH_FRAMES 50000
+/* The frames into each lockstep round that one player stops tracking the ball and moves away from it so the round ends, player 1 in even
+    rounds and player 0 in odd. The other player only moves once the ball would be out within LOCKSTEP_BENCH_LATE_FRAMES frames, half a
+    pixel past its paddle, so a frame simulated with its input predicted as no move often loses the round and has to be rolled back. */
+#define LOCKSTEP_BENCH_MISS_FRAMES 100
+#define LOCKSTEP_BENCH_LATE_FRAMES 6
+/* Frames the crossing benchmark plays, and the times the channel is run between frames so each board has the other's input for the frame. */
+#define CROSSING_BENCH_FRAMES 20000
+#define CROSSING_BENCH_PUMPS 12
+/* The fastest ball the crossing benchmark compares trips for in subpixels per tick. */
+#define CROSSING_BENCH_MAX_VEL 16
+#define SOAK_BENCH_WINDOWS 100
+/* The most messages per SOAK_BENCH_WINDOWS windows that may be resent over a channel with no loss, any more are the link's own timer being
+    too short. */
+#define SOAK_BENCH_CLEAN_RESENDS 10
+#define FRAME_TICKS (TIMER_RATE / FRAME_RATE)
+/* The recorded match is played to the game's winning score, the other player misses after the local player has returned the ball
+    REPLAY_BENCH_RETURNS times, or the local player stops tracking the ball after that many. One frame in REPLAY_BENCH_LONG_FRAME runs late. */
+#define REPLAY_BENCH_WINNING_SCORE 3
+#define REPLAY_BENCH_RETURNS 5
+#define REPLAY_BENCH_LONG_FRAME 97
+#define REPLAY_BENCH_ROUND_FRAMES 100000
+#define REPLAY_BENCH_REPEATS 100
+
+/* Other board functions, see peer.h. */
+void peer_communication_init(void);
+void peer_communication_update(Input_t input);
+bool peer_communication_next_event(CommunicationEvent_t* event);
+const CommunicationBall_t* peer_communication_ball(void);
+void peer_communication_send_physics_info(int16_t ballPosR, int8_t ballVelR, int8_t ballVelC, bool toBack);
+void peer_host_ir_air(uint8_t bytes);
+uint8_t peer_link_frame(void);
+bool peer_link_frame_synced_p(void);
+void bottom_communication_init(void);
+void bottom_communication_update(Input_t input);
+bool bottom_communication_next_event(CommunicationEvent_t* event);
+const CommunicationBall_t* bottom_communication_ball(void);
+void bottom_communication_send_physics_info(int16_t ballPosR, int8_t ballVelR, int8_t ballVelC, bool toBack);
+void bottom_host_ir_air(uint8_t bytes);
+void relay_communication_init(void);
+void relay_communication_update(Input_t input);
+bool relay_communication_next_event(CommunicationEvent_t* event);
+const CommunicationBall_t* relay_communication_ball(void);
+void relay_communication_send_physics_info(int16_t ballPosR, int8_t ballVelR, int8_t ballVelC, bool toBack);
+void relay_host_ir_air(uint8_t bytes);
+void top_communication_init(void);
+void top_communication_update(Input_t input);
+bool top_communication_next_event(CommunicationEvent_t* event);
+const CommunicationBall_t* top_communication_ball(void);
+void top_communication_send_physics_info(int16_t ballPosR, int8_t ballVelR, int8_t ballVelC, bool toBack);
+void top_host_ir_air(uint8_t bytes);
+void peer_lockstep_init(uint8_t player, uint8_t round, uint16_t frameTicks);
+bool peer_lockstep_update(Input_t input);
+PhysicsState_t peer_lockstep_player_state(uint8_t player);
+PhysicsState_t peer_lockstep_confirmed_state(uint8_t player);
+uint8_t peer_lockstep_confirmed_frame(void);
+void peer_lockstep_transmit(void);
+void peer_soak_init(uint8_t frameRate);
+void peer_soak_update(bool sending);
+const SoakResult_t* peer_soak_result(void);
+
+/* The events that matter to the benchmarks from one board in a frame. */
+typedef struct {
+    bool started;
+    bool gotBall;
+    bool fromBack;
+} BenchEvents_t;
+
+/* The number of checks that failed. */
+static uint8_t failures = 0;
+
+/** Reports a check on a benchmark's result, counting it if it failed.
+ * @param passed Whether the check passed.
+ * @param what What was checked.
+*/
+static void bench_check(bool passed, const char* what)
+{
+    if(!passed) {
+        printf("check failed: %s\n", what);
+        failures++;
+    }
+}
+
+/** The current time.
+ * @return Nanoseconds from an arbitrary start.
+*/
+static uint64_t now_ns(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000000000ULL + time.tv_nsec;
+}
+
+/** Takes every event a board queued this frame.
+ * @param next_event The board's communication_next_event.
+ * @return Whether the board started a game with the ball, and whether it recieved the ball and from which side.
+*/
+static BenchEvents_t bench_events(bool (*next_event)(CommunicationEvent_t* event))
+{
+    BenchEvents_t result = {.started = false, .gotBall = false, .fromBack = false};
+    CommunicationEvent_t event;
+    while(next_event(&event)) {
+        if(event.type == COMMUNICATION_START_GAME && event.haveBall) {
+            result.started = true;
+        } else if(event.type == COMMUNICATION_BALL) {
+            result.gotBall = true;
+            result.fromBack = event.fromBack;
+        }
+    }
+    return result;
+}
+
+/** Chooses the input a player tracking the ball would give, with a fixed pseudo random chance of a forward push.
+ * @param state The physics state.
+ * @param random The pseudo random sequence state.
+ * @return The input.
+*/
+static Input_t tracking_input(const PhysicsState_t* state, uint32_t* random)
+{
+    *random = *random * 1103515245 + 12345;
+    uint8_t ballRow = PHYSICS_PIXEL(state->ballPosR);
+    Input_t input = {
+        .north = ballRow < state->paddleR,
+        .south = ballRow > state->paddleR + 1,
+        .west = ((*random >> 16) & 0x3F) == 0,
+        .push = false
+    };
+    return input;
+}
+
+/** Runs physics ticks with a tracking paddle, bouncing the ball straight back whenever it leaves for the other board. */
+static void bench_physics(void)
+{
+    PhysicsState_t state = physics_init(true);
+    uint32_t random = 1;
+    uint32_t handoffs = 0;
+    uint32_t misses = 0;
+
+    uint64_t start = now_ns();
+    for(uint32_t tick = 0; tick < PHYSICS_BENCH_TICKS; tick++) {
+        state = physics_update(state, tracking_input(&state, &random), PHYSICS_PERIOD);
+        if(!state.ballActive) {
+            handoffs++;
+            state.ballActive = true;
+            state.ballPosC = 0;
+        }
+        if(state.gameOver) {
+            misses++;
+            state = physics_init(true);
+        }
+    }
+    uint64_t elapsed = now_ns() - start;
+
+    printf("physics: %lu ticks, %.1f ns/tick, %lu handoffs, %lu misses\n", PHYSICS_BENCH_TICKS,
+        (double)elapsed / PHYSICS_BENCH_TICKS, (unsigned long)handoffs, (unsigned long)misses);
+}
+
+/** Plays the ai paddle against a wall that sends the ball back at random angles and speeds, counting the returns and misses. */
+static void bench_ai(void)
+{
+    PhysicsState_t state = physics_init(true);
+    uint32_t random = 1;
+    uint32_t returns = 0;
+    uint32_t misses = 0;
+
+    uint64_t start = now_ns();
+    for(uint32_t frame = 0; frame < AI_BENCH_FRAMES; frame++) {
+        int8_t velC = state.ballVelC;
+        state = physics_update(state, physics_ai_input(&state), FRAME_TICKS);
+        if(state.ballActive && velC > 0 && state.ballVelC < 0) {
+            returns++;
+        }
+        if(!state.ballActive) {
+            random = random * 1103515245 + 12345;
+            state.ballActive = true;
+            state.ballPosC = 0;
+            state.ballVelR = (int8_t)((random >> 16) % (2 * AI_BENCH_MAX_VEL + 1)) - AI_BENCH_MAX_VEL;
+            state.ballVelC = 1 + (random >> 24) % AI_BENCH_MAX_VEL;
+        }
+        if(state.gameOver) {
+            misses++;
+            state = physics_init(true);
+        }
+    }
+    uint64_t elapsed = now_ns() - start;
+
+    printf("ai: %lu frames, %.1f ns/frame, %lu returns, %lu misses\n", AI_BENCH_FRAMES, (double)elapsed / AI_BENCH_FRAMES,
+        (unsigned long)returns, (unsigned long)misses);
+}
+
+/** Records a match on one board to the eeprom stand in, with a tracking player against a scripted other board that returns each ball
+    straight back, then plays the record back and checks it comes to the same physics state every frame. */
+static void bench_replay(void)
+{
+    Input_t none = {.push = false};
+    host_eeprom_erase();
+    replay_init();
+
+    uint32_t random = 1;
+    uint32_t stateHash = REPLAY_HASH_INIT;
+    uint32_t frames = 0;
+    uint8_t score = 0;
+    uint8_t opponentScore = 0;
+    uint8_t rounds = 0;
+
+    while(score < REPLAY_BENCH_WINNING_SCORE && opponentScore < REPLAY_BENCH_WINNING_SCORE) {
+        /* The local player starts with the ball in the rounds it wins, and loses the others. */
+        bool localLoses = rounds & 1;
+        CommunicationEvent_t start = {.type = COMMUNICATION_START_GAME, .haveBall = !localLoses, .fromBack = false};
+        replay_record_event(start, NULL);
+        PhysicsState_t state = physics_init(start.haveBall);
+        uint16_t elapsed = 0;
+        uint8_t returns = 0;
+        uint16_t away = 0;
+        rounds++;
+
+        for(uint32_t frame = 0; ; frame++) {
+            if(frame == REPLAY_BENCH_ROUND_FRAMES) {
+                printf("replay: round %u didn't end\n", rounds);
+                return;
+            }
+            if(!state.ballActive && ++away >= HOLD_FRAMES) {
+                away = 0;
+                if(!localLoses && returns == REPLAY_BENCH_RETURNS) {
+                    score++;
+                    CommunicationEvent_t end = {
+                        .type = score == REPLAY_BENCH_WINNING_SCORE ? COMMUNICATION_GAME_OVER : COMMUNICATION_END_ROUND,
+                        .haveBall = false,
+                        .fromBack = false
+                    };
+                    replay_record_event(end, NULL);
+                    break;
+                }
+                returns++;
+                CommunicationEvent_t event = {.type = COMMUNICATION_BALL, .haveBall = false, .fromBack = false};
+                CommunicationBall_t ball = {.ballPosR = state.ballPosR, .ballVelR = state.ballVelR, .ballVelC = state.ballVelC, .hopFrames = 4};
+                replay_record_event(event, &ball);
+                state = physics_receive_ball(state, ball.ballPosR, ball.ballVelR, ball.ballVelC, false, ball.hopFrames * FRAME_TICKS);
+            }
+
+            Input_t input = localLoses && returns == REPLAY_BENCH_RETURNS ? none : tracking_input(&state, &random);
+            replay_record_frame(input, elapsed);
+            state = physics_update(state, input, elapsed);
+            stateHash = replay_state_hash(stateHash, &state);
+            frames++;
+            replay_update();
+            elapsed = frames % REPLAY_BENCH_LONG_FRAME == 0 ? FRAME_TICKS + 3 : FRAME_TICKS;
+            if(state.gameOver) {
+                opponentScore++;
+                break;
+            }
+        }
+    }
+    while(replay_writing_p()) {
+        replay_update();
+    }
+
+    ReplaySummary_t summary = replay_play(host_eeprom, sizeof(host_eeprom), FRAME_TICKS, NULL);
+    uint64_t start = now_ns();
+    for(uint8_t i = 0; i < REPLAY_BENCH_REPEATS; i++) {
+        replay_play(host_eeprom, sizeof(host_eeprom), FRAME_TICKS, NULL);
+    }
+    uint64_t playTime = now_ns() - start;
+
+    bool matches = summary.complete && summary.stateHash == stateHash && summary.frames == frames && summary.score == score
+        && summary.opponentScore == opponentScore;
+    printf("replay: %lu frames over %u rounds recorded in %u of %u bytes, %.1f ns/frame played back, %s\n", (unsigned long)frames, rounds,
+        summary.length, (unsigned)sizeof(host_eeprom), (double)playTime / ((double)REPLAY_BENCH_REPEATS * frames), matches ? "matches" : "desynced");
+}
+
+/** Gives each board the airtime of one frame. */
+static void air_frame(void)
+{
+    static uint16_t credit = 0;
+    credit += IR_BYTES_PER_SECOND;
+    uint8_t bytes = credit / FRAME_RATE;
+    credit %= FRAME_RATE;
+    host_ir_air(bytes);
+    peer_host_ir_air(bytes);
+    bottom_host_ir_air(bytes);
+    relay_host_ir_air(bytes);
+    top_host_ir_air(bytes);
+}
+
+/** Starts a game and hands the ball back and forth between the two boards over a lossy channel.
+ * @param lossPercent The percentage of bytes lost in the air.
+ * @param fastEvery The peer's timer runs fast, running an extra frame every this many frames, 0 for none. As the boards' frames are otherwise
+ *  in step, this is what the shared frame counters (see link_frame) are checked against.
+*/
+static void bench_handoff(uint8_t lossPercent, uint16_t fastEvery)
+{
+    Input_t none = {.push = false};
+    Input_t push = {.push = true};
+
+    channel_init(lossPercent, 2);
+    communication_init();
+    peer_communication_init();
+
+    /* -1 while the ball is in the air between boards, otherwise the board holding it (0 local, 1 peer). Like the game, the board that sent
+        the ball keeps sending it each frame until it arrives, as it isn't sent while the link's window is full. */
+    int8_t holder = -1;
+    int8_t sender = -1;
+    uint16_t held = 0;
+    uint32_t frame = 0;
+    uint32_t sentFrame = 0;
+    uint32_t handoffs = 0;
+    uint32_t handoffFrames = 0;
+    uint32_t worstFrames = 0;
+    uint32_t estimateError = 0;
+    uint32_t errors = 0;
+    uint64_t updateTime = 0;
+    uint32_t syncedFrames = 0;
+    uint32_t clockError = 0;
+
+    while(handoffs < HANDOFF_BENCH_COUNT) {
+        uint64_t start = now_ns();
+        communication_update(frame == 0 ? push : none);
+        peer_communication_update(none);
+        if(fastEvery > 0 && frame % fastEvery == (uint32_t)fastEvery - 1) {
+            peer_communication_update(none);
+        }
+        updateTime += now_ns() - start;
+        if(link_frame_synced_p() && peer_link_frame_synced_p()) {
+            syncedFrames++;
+            clockError += abs((int8_t)(link_frame() - peer_link_frame()));
+        }
+        BenchEvents_t local = bench_events(communication_next_event);
+        BenchEvents_t peer = bench_events(peer_communication_next_event);
+        air_frame();
+        frame++;
+
+        if(local.started) {
+            holder = 0;
+        }
+        if(local.gotBall || peer.gotBall) {
+            /* The ball state is tagged with the handoff number so a stale or corrupted handoff is caught. */
+            const CommunicationBall_t* ball = local.gotBall ? communication_ball() : peer_communication_ball();
+            if(ball->ballPosR != (int16_t)handoffs || ball->ballVelR != -3 || ball->ballVelC != 5) {
+                errors++;
+            }
+            uint32_t frames = frame - sentFrame;
+            handoffFrames += frames;
+            if(frames > worstFrames) {
+                worstFrames = frames;
+            }
+            estimateError += abs((int32_t)ball->hopFrames - (int32_t)frames);
+            handoffs++;
+            holder = local.gotBall ? 0 : 1;
+            sender = -1;
+            held = 0;
+        }
+
+        if(holder >= 0 && ++held >= HOLD_FRAMES) {
+            sender = holder;
+            holder = -1;
+            sentFrame = frame;
+        }
+        if(sender == 0) {
+            communication_send_physics_info(handoffs, -3, 5, false);
+        } else if(sender == 1) {
+            peer_communication_send_physics_info(handoffs, -3, 5, false);
+        }
+
+        if(frame - sentFrame > HANDOFF_TIMEOUT_FRAMES) {
+            printf("handoff %2u%% loss%s: stalled after %lu handoffs\n", lossPercent, fastEvery > 0 ? " fast peer" : "", (unsigned long)handoffs);
+            return;
+        }
+    }
+
+    if(fastEvery > 0) {
+        printf("handoff %2u%% loss, peer 1 frame fast in %u: %.2f frames clock error\n", lossPercent, fastEvery,
+            syncedFrames == 0 ? 0.0 : (double)clockError / syncedFrames);
+        return;
+    }
+    printf("handoff %2u%% loss: %.2f frames/handoff (worst %lu), %.2f frames estimate error, %.1f bytes/handoff, %.0f ns/update, %lu errors\n",
+        lossPercent, (double)handoffFrames / handoffs, (unsigned long)worstFrames, (double)estimateError / handoffs,
+        (double)channel_bytes_sent() / handoffs, (double)updateTime / (2.0 * frame), (unsigned long)errors);
+}
+
+/** Starts a game on a three board court, and passes the ball from the bottom player over the relay board to the top player and back
+    over a lossy channel. The relay hands the ball on the way it was going, as the ball crosses it.
+ * @param lossPercent The percentage of bytes lost in the air.
+*/
+static void bench_relay(uint8_t lossPercent)
+{
+    Input_t none = {.push = false};
+    Input_t push = {.push = true};
+
+    channel_init(lossPercent, CHANNEL_ENDS);
+    bottom_communication_init();
+    relay_communication_init();
+    top_communication_init();
+
+    /* -1 while the ball is in the air between boards, otherwise the board holding it (0 bottom, 1 relay, 2 top), and the board that sent it,
+        which sends it each frame until it arrives, as in bench_handoff. */
+    int8_t holder = -1;
+    int8_t sender = -1;
+    bool towardsTop = true;
+    uint16_t held = 0;
+    uint32_t frame = 0;
+    uint32_t sentFrame = 0;
+    uint32_t hops = 0;
+    uint32_t seamHops[2] = {0, 0};
+    uint32_t seamFrames[2] = {0, 0};
+    uint32_t worstFrames = 0;
+    uint32_t estimateError = 0;
+    uint32_t errors = 0;
+
+    while(hops < HANDOFF_BENCH_COUNT) {
+        bottom_communication_update(frame == 0 ? push : none);
+        relay_communication_update(none);
+        top_communication_update(none);
+        air_frame();
+        frame++;
+
+        BenchEvents_t boards[3] = {
+            bench_events(bottom_communication_next_event),
+            bench_events(relay_communication_next_event),
+            bench_events(top_communication_next_event)
+        };
+        if(boards[0].started) {
+            holder = 0;
+        }
+        for(uint8_t board = 0; board < 3; board++) {
+            if(!boards[board].gotBall) {
+                continue;
+            }
+            const CommunicationBall_t* ball = board == 0 ? bottom_communication_ball() : board == 1 ? relay_communication_ball() : top_communication_ball();
+            /* The relay recieves over its back edge, seam 1, on the way to the bottom. */
+            bool expectBack = board == 1 && !towardsTop;
+            if(ball->ballPosR != (int16_t)hops || ball->ballVelR != -3 || ball->ballVelC != 5 || boards[board].fromBack != expectBack) {
+                errors++;
+            }
+            uint8_t seam = board == 2 || expectBack;
+            uint32_t frames = frame - sentFrame;
+            seamFrames[seam] += frames;
+            seamHops[seam]++;
+            if(frames > worstFrames) {
+                worstFrames = frames;
+            }
+            estimateError += abs((int32_t)ball->hopFrames - (int32_t)frames);
+            hops++;
+            holder = board;
+            sender = -1;
+            held = 0;
+            if(board != 1) {
+                towardsTop = board == 0;
+            }
+        }
+
+        if(holder >= 0 && ++held >= HOLD_FRAMES) {
+            sender = holder;
+            holder = -1;
+            sentFrame = frame;
+        }
+        if(sender == 0) {
+            bottom_communication_send_physics_info(hops, -3, 5, false);
+        } else if(sender == 1) {
+            relay_communication_send_physics_info(hops, -3, 5, towardsTop);
+        } else if(sender == 2) {
+            top_communication_send_physics_info(hops, -3, 5, false);
+        }
+
+        if(frame - sentFrame > HANDOFF_TIMEOUT_FRAMES) {
+            printf("relay   %2u%% loss: stalled after %lu hops\n", lossPercent, (unsigned long)hops);
+            return;
+        }
+    }
+
+    printf("relay   %2u%% loss: %.2f frames/hop over seam 0, %.2f over seam 1 (worst %lu), %.2f frames estimate error, %.1f bytes/hop, %lu errors\n",
+        lossPercent, (double)seamFrames[0] / seamHops[0], (double)seamFrames[1] / seamHops[1], (unsigned long)worstFrames,
+        (double)estimateError / hops, (double)channel_bytes_sent() / hops, (unsigned long)errors);
+}
+
+/** Hashes both players' physics states so the two funkits' simulations can be compared.
+ * @param players The physics state of each player.
+ * @return The hash.
+*/
+static uint32_t lockstep_hash(const PhysicsState_t* players)
+{
+    uint32_t hash = 0;
+    for(uint8_t player = 0; player < LOCKSTEP_NUM_PLAYERS; player++) {
+        const PhysicsState_t* state = &players[player];
+        int32_t fields[] = {state->ballActive, state->gameOver, state->ballPosR, state->ballPosC, state->ballVelR, state->ballVelC,
+            state->paddleC, state->paddleR, state->paddleForwardTicks, state->paddleBoost, state->tickAccumulator};
+        for(uint8_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+            hash = hash * 31 + (uint32_t)fields[i];
+        }
+    }
+    return hash;
+}
+
+/** Plays lockstep rounds between the two boards over a lossy channel, each board's player tracking the ball until one player turns away to
+    end the round, checking both boards end each round on the same confirmed frame with the same scores.
+ * @param lossPercent The percentage of bytes lost in the air.
+*/
+static void bench_lockstep(uint8_t lossPercent)
+{
+    /* The hash of each confirmed frame on each board, counted from the start of the run. 0 if the board's confirmed frame skipped over it. */
+    static uint32_t hashes[LOCKSTEP_NUM_PLAYERS][LOCKSTEP_BENCH_FRAMES];
+    Input_t none = {.push = false};
+
+    for(uint8_t board = 0; board < LOCKSTEP_NUM_PLAYERS; board++) {
+        for(uint32_t i = 0; i < LOCKSTEP_BENCH_FRAMES; i++) {
+            hashes[board][i] = 0;
+        }
+    }
+    channel_init(lossPercent, 2);
+    communication_init();
+    peer_communication_init();
+    lockstep_init(0, 0, FRAME_TICKS);
+    peer_lockstep_init(1, 0, FRAME_TICKS);
+
+    /* Board 0 is player 0 and board 1 player 1. */
+    uint32_t random[LOCKSTEP_NUM_PLAYERS] = {1, 2};
+    uint32_t roundStart = 0;
+    uint32_t confirmed[LOCKSTEP_NUM_PLAYERS] = {0, 0};
+    uint8_t confirmedFrame[LOCKSTEP_NUM_PLAYERS] = {0, 0};
+    bool roundOver[LOCKSTEP_NUM_PLAYERS] = {false, false};
+    uint8_t round = 0;
+    uint32_t roundFrame = 0;
+    uint32_t waits = 0;
+    /* Each board's score for each player, and the last confirmed frame of the round each board saw before the loss and the first it saw after
+        it. A board's confirmed frame can move on several frames at once, so the loss is somewhere after the one and up to the other, and both
+        boards ending on the same frame means the two ranges overlap. */
+    uint8_t scores[LOCKSTEP_NUM_PLAYERS][LOCKSTEP_NUM_PLAYERS] = {{0, 0}, {0, 0}};
+    uint32_t lastPlaying[LOCKSTEP_NUM_PLAYERS] = {0, 0};
+    uint32_t firstOver[LOCKSTEP_NUM_PLAYERS] = {0, 0};
+    bool predictedOver[LOCKSTEP_NUM_PLAYERS] = {false, false};
+    uint32_t rolledBackLosses = 0;
+    uint32_t badEnds = 0;
+
+    for(uint32_t frame = 0; frame < LOCKSTEP_BENCH_FRAMES; frame++, roundFrame++) {
+        communication_update(none);
+        peer_communication_update(none);
+
+        for(uint8_t board = 0; board < LOCKSTEP_NUM_PLAYERS; board++) {
+            if(roundOver[board]) {
+                continue;
+            }
+            PhysicsState_t state = board == 0 ? lockstep_player_state(board) : peer_lockstep_player_state(board);
+            Input_t input = tracking_input(&state, &random[board]);
+            if(board != (round & 1) && roundFrame >= LOCKSTEP_BENCH_MISS_FRAMES) {
+                bool north = input.north;
+                input.north = input.south;
+                input.south = north;
+            } else if(board == (round & 1) && !(state.ballVelC > 0 && state.ballPosC + state.ballVelC * (FRAME_TICKS / PHYSICS_PERIOD)
+                * LOCKSTEP_BENCH_LATE_FRAMES >= state.paddleC * PHYSICS_SUBPIXEL + PHYSICS_SUBPIXEL / 2)) {
+                input.north = false;
+                input.south = false;
+            }
+            bool changed = board == 0 ? lockstep_update(input) : peer_lockstep_update(input);
+            if(!changed) {
+                waits++;
+            }
+
+            /* A loss simulated with a predicted input that the real input undoes is rolled back. */
+            bool over = false;
+            for(uint8_t player = 0; player < LOCKSTEP_NUM_PLAYERS; player++) {
+                over |= (board == 0 ? lockstep_player_state(player) : peer_lockstep_player_state(player)).gameOver;
+            }
+            if(predictedOver[board] && !over) {
+                rolledBackLosses++;
+            }
+            predictedOver[board] = over;
+
+            /* Confirmed frames only go forwards, count them from the start of the round. */
+            uint8_t nowConfirmed = board == 0 ? lockstep_confirmed_frame() : peer_lockstep_confirmed_frame();
+            confirmed[board] += (uint8_t)(nowConfirmed - confirmedFrame[board]);
+            confirmedFrame[board] = nowConfirmed;
+
+            PhysicsState_t players[LOCKSTEP_NUM_PLAYERS];
+            for(uint8_t player = 0; player < LOCKSTEP_NUM_PLAYERS; player++) {
+                players[player] = board == 0 ? lockstep_confirmed_state(player) : peer_lockstep_confirmed_state(player);
+                /* As in game.c, the player whose confirmed state has lost gives the other player the point. */
+                if(players[player].gameOver && !roundOver[board]) {
+                    scores[board][!player]++;
+                    firstOver[board] = confirmed[board];
+                }
+                roundOver[board] |= players[player].gameOver;
+            }
+            if(!roundOver[board]) {
+                lastPlaying[board] = confirmed[board];
+            }
+            uint32_t index = roundStart + confirmed[board];
+            if(index < LOCKSTEP_BENCH_FRAMES) {
+                hashes[board][index] = lockstep_hash(players);
+            }
+        }
+
+        lockstep_transmit();
+        peer_lockstep_transmit();
+        air_frame();
+
+        /* A new round is only started once both boards have finished the last, as the start handshake ensures in the game. */
+        if(roundOver[0] && roundOver[1]) {
+            bool sameFrame = lastPlaying[0] < firstOver[1] && lastPlaying[1] < firstOver[0];
+            bool sameScores = scores[0][0] == scores[1][0] && scores[0][1] == scores[1][1];
+            badEnds += !sameFrame || !sameScores;
+            round++;
+            roundFrame = 0;
+            roundStart += confirmed[0] > confirmed[1] ? confirmed[0] : confirmed[1];
+            roundStart++;
+            lockstep_init(0, round, FRAME_TICKS);
+            peer_lockstep_init(1, round, FRAME_TICKS);
+            for(uint8_t board = 0; board < LOCKSTEP_NUM_PLAYERS; board++) {
+                roundOver[board] = false;
+                confirmed[board] = 0;
+                confirmedFrame[board] = 0;
+                lastPlaying[board] = 0;
+                predictedOver[board] = false;
+            }
+        }
+    }
+
+    uint32_t compared = 0;
+    uint32_t desyncs = 0;
+    for(uint32_t i = 0; i < LOCKSTEP_BENCH_FRAMES; i++) {
+        if(hashes[0][i] != 0 && hashes[1][i] != 0) {
+            compared++;
+            desyncs += hashes[0][i] != hashes[1][i];
+        }
+    }
+    printf("lockstep %2u%% loss: %.2f%% of frames waiting, %.1f bytes/frame, %u rounds (%u-%u), %lu predicted losses rolled back, "
+        "%lu of %lu confirmed frames desynced\n", lossPercent, 100.0 * waits / (2.0 * LOCKSTEP_BENCH_FRAMES),
+        (double)channel_bytes_sent() / (2.0 * LOCKSTEP_BENCH_FRAMES), round, scores[0][0], scores[0][1], (unsigned long)rolledBackLosses,
+        (unsigned long)desyncs, (unsigned long)compared);
+    bench_check(round > 0, "lockstep rounds end");
+    bench_check(badEnds == 0, "both boards end each lockstep round on the same confirmed frame with the same scores");
+    bench_check(desyncs == 0, "both boards confirm the same lockstep game");
+}
+
+/** Plays lockstep rallies between ai paddles over a clean channel, sending each board's input to the other before the next frame so each
+    update confirms the frame before it and every frame is seen. A trip is from the frame the ball leaves a player's half until it is back,
+    and trips that leave from the same column at the same speed cover the same path, so should take as many frames whichever half they
+    leave. The ball's speed is varied by pseudo random forward pushes, so the columns it leaves from aren't tied to one half.
+*/
+static void bench_lockstep_crossing(void)
+{
+    /* The frames of the first trip seen from each player's half for each speed and column, 0 if there hasn't been one. */
+    static uint16_t tripFrames[LOCKSTEP_NUM_PLAYERS][CROSSING_BENCH_MAX_VEL + 1][CROSSING_BENCH_MAX_VEL];
+    Input_t none = {.push = false};
+
+    for(uint8_t player = 0; player < LOCKSTEP_NUM_PLAYERS; player++) {
+        for(uint8_t vel = 0; vel <= CROSSING_BENCH_MAX_VEL; vel++) {
+            for(uint8_t col = 0; col < CROSSING_BENCH_MAX_VEL; col++) {
+                tripFrames[player][vel][col] = 0;
+            }
+        }
+    }
+    channel_init(0, 2);
+    communication_init();
+    peer_communication_init();
+    lockstep_init(0, 0, FRAME_TICKS);
+    peer_lockstep_init(1, 0, FRAME_TICKS);
+
+    uint32_t random[LOCKSTEP_NUM_PLAYERS] = {1, 2};
+    uint8_t simFrame = 0;
+    uint8_t round = 0;
+    uint32_t unconfirmed = 0;
+    /* The player with the ball and its state last frame, and the frame, speed and column of the trip from the half it isn't on, which isn't
+        compared if that player's paddle was forward while the ball was on its half as a forward paddle sends the ball back sooner. */
+    uint8_t ballPlayer = 0;
+    PhysicsState_t last = lockstep_confirmed_state(0);
+    bool tripping = false;
+    bool tripPushed = false;
+    uint32_t tripStart = 0;
+    uint8_t tripVel = 0;
+    uint8_t tripCol = 0;
+    uint32_t trips = 0;
+    uint32_t compared = 0;
+    uint32_t mismatches = 0;
+
+    for(uint32_t frame = 0; frame < CROSSING_BENCH_FRAMES; frame++) {
+        for(uint8_t board = 0; board < LOCKSTEP_NUM_PLAYERS; board++) {
+            PhysicsState_t state = board == 0 ? lockstep_player_state(board) : peer_lockstep_player_state(board);
+            Input_t input = physics_ai_input(&state);
+            input.west = tracking_input(&state, &random[board]).west;
+            if(board == 0) {
+                lockstep_update(input);
+            } else {
+                peer_lockstep_update(input);
+            }
+        }
+        simFrame++;
+        if(lockstep_confirmed_frame() != (uint8_t)(simFrame - 1)) {
+            unconfirmed++;
+        }
+        for(uint8_t pump = 0; pump < CROSSING_BENCH_PUMPS; pump++) {
+            lockstep_transmit();
+            peer_lockstep_transmit();
+            air_frame();
+            communication_update(none);
+            peer_communication_update(none);
+        }
+
+        PhysicsState_t players[LOCKSTEP_NUM_PLAYERS] = {lockstep_confirmed_state(0), lockstep_confirmed_state(1)};
+        if(players[0].gameOver || players[1].gameOver) {
+            round++;
+            simFrame = 0;
+            lockstep_init(0, round, FRAME_TICKS);
+            peer_lockstep_init(1, round, FRAME_TICKS);
+            ballPlayer = 0;
+            last = lockstep_confirmed_state(0);
+            tripping = false;
+            continue;
+        }
+        tripPushed |= players[ballPlayer].paddleForwardTicks > 0;
+        if(!players[!ballPlayer].ballActive) {
+            last = players[ballPlayer];
+            continue;
+        }
+
+        /* The ball has crossed, ending the trip from the half it is back on unless a push changed its path on the way. */
+        ballPlayer = !ballPlayer;
+        uint8_t vel = abs(last.ballVelC);
+        if(tripping && !tripPushed && vel == tripVel) {
+            uint16_t frames = frame - tripStart;
+            trips++;
+            if(tripFrames[!ballPlayer][tripVel][tripCol] != 0) {
+                compared++;
+                mismatches += tripFrames[!ballPlayer][tripVel][tripCol] != frames;
+            }
+            if(tripFrames[ballPlayer][tripVel][tripCol] == 0) {
+                tripFrames[ballPlayer][tripVel][tripCol] = frames;
+            }
+        }
+        tripping = vel <= CROSSING_BENCH_MAX_VEL && last.ballPosC < CROSSING_BENCH_MAX_VEL;
+        tripStart = frame;
+        tripVel = vel;
+        tripCol = last.ballPosC;
+        tripPushed = false;
+        last = players[ballPlayer];
+    }
+
+    printf("lockstep crossing: %lu trips, %lu compared with a trip from the other half, %lu of them taking a different number of frames, "
+        "%u rounds\n", (unsigned long)trips, (unsigned long)compared, (unsigned long)mismatches, round);
+    bench_check(unconfirmed == 0, "each lockstep frame is confirmed before the next");
+    bench_check(compared > 0, "the ball leaves both halves from the same columns at the same speeds");
+    bench_check(mismatches == 0, "the ball takes as long to cross to either half and back");
+}
+
+/** Runs the ir soak test between the two boards over a lossy channel, averaging the local board's results.
+ * @param lossPercent The percentage of bytes lost in the air.
+ * @param bothWays Whether the peer sends test messages too, otherwise it only acknowledges.
+*/
+static void bench_soak(uint8_t lossPercent, bool bothWays)
+{
+    channel_init(lossPercent, 2);
+    soak_init(FRAME_RATE);
+    peer_soak_init(FRAME_RATE);
+
+    uint32_t bytesPerSecond = 0;
+    uint32_t delivered = 0;
+    uint32_t lost = 0;
+    uint32_t sent = 0;
+    uint32_t acked = 0;
+    uint32_t resent = 0;
+    uint32_t lostMessages = 0;
+    uint32_t duplicates = 0;
+    uint32_t errors = 0;
+    for(uint16_t window = 0; window < SOAK_BENCH_WINDOWS; window++) {
+        for(uint8_t frame = 0; frame < SOAK_WINDOW_FRAMES; frame++) {
+            soak_update(true);
+            peer_soak_update(bothWays);
+            air_frame();
+        }
+        const SoakResult_t* result = soak_result();
+        bytesPerSecond += result->bytesPerSecond;
+        delivered += peer_soak_result()->bytesPerSecond;
+        lost += result->lossPercent;
+        sent += result->sent;
+        acked += result->acked;
+        resent += result->resent;
+        lostMessages += result->lost;
+        duplicates += result->duplicates;
+        errors += result->errors + peer_soak_result()->errors;
+    }
+
+    /* The local board's throughput is of the data it recieves, which one way is the peer's acks alone, what it delivers is the peer's. */
+    printf("soak %s %2u%% loss: %lu bytes/s recieved, %lu bytes/s delivered, %lu%% loss, per window %.1f sent, %.1f acked, %.1f resent, "
+        "%.1f lost, %.1f duplicates, %lu errors\n", bothWays ? "both ways" : "one way  ", lossPercent,
+        (unsigned long)(bytesPerSecond / SOAK_BENCH_WINDOWS), (unsigned long)(delivered / SOAK_BENCH_WINDOWS), (unsigned long)(lost / SOAK_BENCH_WINDOWS),
+        (double)sent / SOAK_BENCH_WINDOWS, (double)acked / SOAK_BENCH_WINDOWS, (double)resent / SOAK_BENCH_WINDOWS,
+        (double)lostMessages / SOAK_BENCH_WINDOWS, (double)duplicates / SOAK_BENCH_WINDOWS, (unsigned long)errors);
+    if(lossPercent == 0) {
+        bench_check(resent <= SOAK_BENCH_CLEAN_RESENDS, "a clean channel resends almost no messages");
+        bench_check(lost < SOAK_BENCH_WINDOWS, "a clean channel reports about 0% loss");
+    } else {
+        bench_check(lost > 0, "a lossy channel reports some loss");
+    }
+}
+
+/** Entry point. */
+int main(void)
+{
+    bench_physics();
+    bench_ai();
+    bench_replay();
+
+    const uint8_t losses[] = {0, 1, 2, 5, 10};
+    for(uint8_t i = 0; i < sizeof(losses); i++) {
+        bench_handoff(losses[i], 0);
+    }
+    bench_handoff(0, 1000);
+    bench_handoff(0, 100);
+    bench_handoff(10, 1000);
+    for(uint8_t i = 0; i < sizeof(losses); i++) {
+        bench_relay(losses[i]);
+    }
+    for(uint8_t i = 0; i < sizeof(losses); i++) {
+        bench_lockstep(losses[i]);
+    }
+    bench_lockstep_crossing();
+    for(uint8_t i = 0; i < sizeof(losses); i++) {
+        bench_soak(losses[i], true);
+    }
+    bench_soak(0, false);
+    bench_soak(10, false);
+    return failures > 0;
+}
@@ -0,0 +1,73 @@
+/** @file channel.c
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Simulated ir channel between funkits for the host build, with airtime limited to the ir baud rate and optional byte loss.
+    Every byte is heard by every other board in use, as boards along a court can all see each other.
+*/
+
+#include "channel.h"
+
+#define CHANNEL_SIZE 256
+
+static uint8_t buffers[CHANNEL_ENDS][CHANNEL_SIZE];
+static uint8_t heads[CHANNEL_ENDS];
+static uint8_t tails[CHANNEL_ENDS];
+static uint8_t numEnds = 2;
+static uint8_t loss = 0;
+static uint32_t lossRandom = 1;
+static uint32_t bytesSent = 0;
+
+/** Empties the channel and sets the loss rate.
+ * @param lossPercent The percentage of bytes lost in the air, chosen by a fixed pseudo lossRandom sequence so runs repeat exactly.
+ * @param ends The number of ends in use, from CHANNEL_LOCAL, each byte is lost or not seperately at each end that hears it.
+*/
+void channel_init(uint8_t lossPercent, uint8_t ends)
+{
+    for(uint8_t end = 0; end < CHANNEL_ENDS; end++) {
+        heads[end] = tails[end] = 0;
+    }
+    numEnds = ends;
+    loss = lossPercent;
+    lossRandom = 1;
+    bytesSent = 0;
+}
+
+/** Puts a byte in the air from one end, it may be lost.
+ * @param from The end sending the byte.
+ * @param data The byte.
+*/
+void channel_send(uint8_t from, uint8_t data)
+{
+    bytesSent++;
+    for(uint8_t to = 0; to < numEnds; to++) {
+        if(to == from) {
+            continue;
+        }
+        lossRandom = lossRandom * 1103515245 + 12345;
+        if((lossRandom >> 16) % 100 < loss) {
+            continue;
+        }
+        buffers[to][heads[to]++] = data;
+    }
+}
+
+/** Takes the next byte recieved at one end.
+ * @param to The end recieving.
+ * @param data Filled in with the byte.
+ * @return False if there is no byte waiting.
+*/
+bool channel_receive(uint8_t to, uint8_t* data)
+{
+    if(heads[to] == tails[to]) {
+        return false;
+    }
+    *data = buffers[to][tails[to]++];
+    return true;
+}
+
+/** The number of bytes put in the air since channel_init, including lost bytes.
+ * @return The byte count.
+*/
+uint32_t channel_bytes_sent(void)
+{
+    return bytesSent;
+}
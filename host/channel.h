@@ -0,0 +1,43 @@
+/** @file channel.h
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Simulated ir channel between funkits for the host build, with airtime limited to the ir baud rate and optional byte loss.
+    Every byte is heard by every other board in use, as boards along a court can all see each other.
+*/
+
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include "system.h"
+
+/* The ends of the channel, the board under test and the other boards (see peer.h). */
+#define CHANNEL_LOCAL 0
+#define CHANNEL_PEER 1
+#define CHANNEL_RELAY 2
+#define CHANNEL_TOP 3
+#define CHANNEL_ENDS 4
+
+/** Empties the channel and sets the loss rate.
+ * @param lossPercent The percentage of bytes lost in the air, chosen by a fixed pseudo random sequence so runs repeat exactly.
+ * @param ends The number of ends in use, from CHANNEL_LOCAL, each byte is lost or not seperately at each end that hears it.
+*/
+void channel_init(uint8_t lossPercent, uint8_t ends);
+
+/** Puts a byte in the air from one end, it may be lost.
+ * @param from The end sending the byte.
+ * @param data The byte.
+*/
+void channel_send(uint8_t from, uint8_t data);
+
+/** Takes the next byte recieved at one end.
+ * @param to The end recieving.
+ * @param data Filled in with the byte.
+ * @return False if there is no byte waiting.
+*/
+bool channel_receive(uint8_t to, uint8_t* data);
+
+/** The number of bytes put in the air since channel_init, including lost bytes.
+ * @return The byte count.
+*/
+uint32_t channel_bytes_sent(void);
+
+#endif //CHANNEL_H
\ No newline at end of file
@@ -0,0 +1,15 @@
+/** @file eeprom.c
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Host stand in for the avr eeprom, an array that is always ready to write.
+*/
+
+#include <avr/eeprom.h>
+#include <string.h>
+
+uint8_t host_eeprom[E2END + 1];
+
+/** Erases the eeprom, every byte reads 0xFF as erased eeprom does. */
+void host_eeprom_erase(void)
+{
+    memset(host_eeprom, 0xFF, sizeof(host_eeprom));
+}
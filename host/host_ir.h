@@ -0,0 +1,16 @@
+/** @file host_ir.h
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Host only additions to the ir queue stand in.
+*/
+
+#ifndef HOST_IR_H
+#define HOST_IR_H
+
+#include "system.h"
+
+/** Moves up to a number of queued bytes into the air, standing in for the time the uart takes to send them.
+ * @param bytes The most bytes to send.
+*/
+void host_ir_air(uint8_t bytes);
+
+#endif //HOST_IR_H
\ No newline at end of file
@@ -0,0 +1,103 @@
+/** @file ir_queue.c
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Host stand in for the ir queue, connected to one end of the simulated channel. Built again with peer.h for each other board.
+*/
+
+#include "ir_queue.h"
+#include "channel.h"
+#include "host_ir.h"
+
+#ifndef HOST_CHANNEL_END
+#define HOST_CHANNEL_END CHANNEL_LOCAL
+#endif
+
+#define TX_MASK (IR_QUEUE_TX_SIZE - 1)
+
+/* Bytes wait here until host_ir_air gives them airtime, as the uart only sends at the baud rate. */
+static uint8_t txBuffer[IR_QUEUE_TX_SIZE];
+static uint8_t txHead = 0;
+static uint8_t txTail = 0;
+
+/* A byte taken from the channel by ir_queue_read_ready_p but not yet read. */
+static bool rxWaiting = false;
+static uint8_t rxByte;
+
+/** Initializes the ir uart and enables the receive interrupt, which fills the receive buffer as bytes arrive, the transmit interrupt is enabled as bytes are queued. */
+void ir_queue_init(void)
+{
+    txHead = 0;
+    txTail = 0;
+    rxWaiting = false;
+}
+
+/** Checks if there is a byte waiting in the receive buffer.
+ * @return True if ir_queue_getc will return a byte.
+*/
+bool ir_queue_read_ready_p(void)
+{
+    if(!rxWaiting) {
+        rxWaiting = channel_receive(HOST_CHANNEL_END, &rxByte);
+    }
+    return rxWaiting;
+}
+
+/** Takes the oldest byte from the receive buffer, should only be called if ir_queue_read_ready_p is true.
+ * @return The oldest recieved byte.
+*/
+uint8_t ir_queue_getc(void)
+{
+    ir_queue_read_ready_p();
+    rxWaiting = false;
+    return rxByte;
+}
+
+/** The number of bytes that can currently be queued for transmission.
+ * @return The free space in the transmit buffer.
+*/
+uint8_t ir_queue_write_space(void)
+{
+    return (txTail - txHead - 1) & TX_MASK;
+}
+
+/** Queues a byte to be sent over the ir channel by the transmit interrupt, returning immediately.
+ * @param data The byte to send.
+ * @return False if the transmit buffer is full and the byte was not queued.
+*/
+bool ir_queue_putc(uint8_t data)
+{
+    uint8_t next = (txHead + 1) & TX_MASK;
+    if(next == txTail) {
+        return false;
+    }
+    txBuffer[txHead] = data;
+    txHead = next;
+    return true;
+}
+
+/** Checks if every queued byte has been handed to the uart.
+ * @return True if the transmit buffer is empty.
+*/
+bool ir_queue_write_empty_p(void)
+{
+    return txHead == txTail;
+}
+
+/** The number of bytes dropped because the receive buffer was full or the uart reported an error.
+ * @return The dropped byte count, always 0 as the channel holds every byte.
+*/
+uint8_t ir_queue_dropped(void)
+{
+    return 0;
+}
+
+/** Moves up to a number of queued bytes into the air, standing in for the time the uart takes to send them.
+ * @param bytes The most bytes to send.
+*/
+void host_ir_air(uint8_t bytes)
+{
+    while(bytes > 0 && txHead != txTail) {
+        channel_send(HOST_CHANNEL_END, txBuffer[txTail]);
+        txTail = (txTail + 1) & TX_MASK;
+        bytes--;
+    }
+}
@@ -0,0 +1,32 @@
+/** @file led.c
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Host stand in for the funkit led driver, remembers the led state so it can be checked.
+*/
+
+#include "led.h"
+
+static bool ledState = false;
+
+/** Initializes the led, off. */
+void led_init(void)
+{
+    ledState = false;
+}
+
+/** Sets the led.
+ * @param led The led, only LED1 exists.
+ * @param state True to turn the led on.
+*/
+void led_set(uint8_t led, bool state)
+{
+    (void)led;
+    ledState = state;
+}
+
+/** The state the led was last set to.
+ * @return True if the led is on.
+*/
+bool led_get(void)
+{
+    return ledState;
+}
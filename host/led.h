@@ -0,0 +1,27 @@
+/** @file led.h
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Host stand in for the funkit led driver, remembers the led state so it can be checked.
+*/
+
+#ifndef LED_H
+#define LED_H
+
+#include "system.h"
+
+#define LED1 0
+
+/** Initializes the led, off. */
+void led_init(void);
+
+/** Sets the led.
+ * @param led The led, only LED1 exists.
+ * @param state True to turn the led on.
+*/
+void led_set(uint8_t led, bool state);
+
+/** The state the led was last set to.
+ * @return True if the led is on.
+*/
+bool led_get(void);
+
+#endif //LED_H
\ No newline at end of file
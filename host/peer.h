@@ -0,0 +1,73 @@
+/** @file peer.h
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Renames the public functions of the communication modules so more copies, the other boards, can be linked into the host benchmark.
+    Force included (gcc -include) when building each other board's objects. Any new public function in these modules must be added here.
+*/
+
+#ifndef PEER_H
+#define PEER_H
+
+/* The prefix given to each name and the board's end of the channel are set on the command line, e.g. -DHOST_BOARD=relay_
+    -DHOST_CHANNEL_END=CHANNEL_RELAY, the default is the peer board. */
+#ifndef HOST_BOARD
+#define HOST_BOARD peer_
+#define HOST_CHANNEL_END CHANNEL_PEER
+#endif
+#define HOST_RENAME_(board, name) board##name
+#define HOST_RENAME(board, name) HOST_RENAME_(board, name)
+
+#define communication_init HOST_RENAME(HOST_BOARD, communication_init)
+#define communication_send_end_round HOST_RENAME(HOST_BOARD, communication_send_end_round)
+#define communication_send_end_game HOST_RENAME(HOST_BOARD, communication_send_end_game)
+#define communication_finish_round HOST_RENAME(HOST_BOARD, communication_finish_round)
+#define communication_send_physics_info HOST_RENAME(HOST_BOARD, communication_send_physics_info)
+#define communication_update HOST_RENAME(HOST_BOARD, communication_update)
+#define communication_idle_p HOST_RENAME(HOST_BOARD, communication_idle_p)
+#define communication_next_event HOST_RENAME(HOST_BOARD, communication_next_event)
+#define communication_ball HOST_RENAME(HOST_BOARD, communication_ball)
+
+#define link_init HOST_RENAME(HOST_BOARD, link_init)
+#define link_send HOST_RENAME(HOST_BOARD, link_send)
+#define link_idle_p HOST_RENAME(HOST_BOARD, link_idle_p)
+#define link_quiet_p HOST_RENAME(HOST_BOARD, link_quiet_p)
+#define link_receive_frame HOST_RENAME(HOST_BOARD, link_receive_frame)
+#define link_read HOST_RENAME(HOST_BOARD, link_read)
+#define link_latency HOST_RENAME(HOST_BOARD, link_latency)
+#define link_loss HOST_RENAME(HOST_BOARD, link_loss)
+#define link_update HOST_RENAME(HOST_BOARD, link_update)
+#define link_transmit HOST_RENAME(HOST_BOARD, link_transmit)
+#define link_stats HOST_RENAME(HOST_BOARD, link_stats)
+#define link_frame HOST_RENAME(HOST_BOARD, link_frame)
+#define link_frame_synced_p HOST_RENAME(HOST_BOARD, link_frame_synced_p)
+
+#define lockstep_init HOST_RENAME(HOST_BOARD, lockstep_init)
+#define lockstep_receive_frame HOST_RENAME(HOST_BOARD, lockstep_receive_frame)
+#define lockstep_update HOST_RENAME(HOST_BOARD, lockstep_update)
+#define lockstep_player_state HOST_RENAME(HOST_BOARD, lockstep_player_state)
+#define lockstep_confirmed_state HOST_RENAME(HOST_BOARD, lockstep_confirmed_state)
+#define lockstep_confirmed_frame HOST_RENAME(HOST_BOARD, lockstep_confirmed_frame)
+#define lockstep_transmit HOST_RENAME(HOST_BOARD, lockstep_transmit)
+
+#define soak_init HOST_RENAME(HOST_BOARD, soak_init)
+#define soak_update HOST_RENAME(HOST_BOARD, soak_update)
+#define soak_result HOST_RENAME(HOST_BOARD, soak_result)
+
+#define frame_crc16 HOST_RENAME(HOST_BOARD, frame_crc16)
+#define frame_encode HOST_RENAME(HOST_BOARD, frame_encode)
+#define frame_decoder_init HOST_RENAME(HOST_BOARD, frame_decoder_init)
+#define frame_decode HOST_RENAME(HOST_BOARD, frame_decode)
+
+#define ir_queue_init HOST_RENAME(HOST_BOARD, ir_queue_init)
+#define ir_queue_read_ready_p HOST_RENAME(HOST_BOARD, ir_queue_read_ready_p)
+#define ir_queue_getc HOST_RENAME(HOST_BOARD, ir_queue_getc)
+#define ir_queue_write_space HOST_RENAME(HOST_BOARD, ir_queue_write_space)
+#define ir_queue_putc HOST_RENAME(HOST_BOARD, ir_queue_putc)
+#define ir_queue_write_empty_p HOST_RENAME(HOST_BOARD, ir_queue_write_empty_p)
+#define ir_queue_dropped HOST_RENAME(HOST_BOARD, ir_queue_dropped)
+#define host_ir_air HOST_RENAME(HOST_BOARD, host_ir_air)
+
+#define led_init HOST_RENAME(HOST_BOARD, led_init)
+#define led_set HOST_RENAME(HOST_BOARD, led_set)
+#define led_get HOST_RENAME(HOST_BOARD, led_get)
+
+#endif //PEER_H
\ No newline at end of file
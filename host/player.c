@@ -0,0 +1,64 @@
+/** @file player.c
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Plays back a match recorded to a funkit's eeprom (see replay.h), read with make dump-replay, printing each event and checking how
+    fast the match is re-simulated.
+*/
+
+#include "system.h"
+#include "timer.h"
+#include "replay_player.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* The eeprom size of the ATmega32U2, and the frame rate the game runs at (REFRESH_RATE in game.c). */
+#define PLAYER_MAX_RECORD 1024
+#define PLAYER_FRAME_RATE 50
+#define PLAYER_FRAME_TICKS (TIMER_RATE / PLAYER_FRAME_RATE)
+/* Times the match is played back to measure the speed. */
+#define PLAYER_REPEATS 1000
+
+/** The current time.
+ * @return Nanoseconds from an arbitrary start.
+*/
+static uint64_t now_ns(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000000000ULL + time.tv_nsec;
+}
+
+/** Entry point.
+ * @param argc The number of arguments.
+ * @param argv The record file, a raw eeprom dump, and -q to only print the summary.
+ * @return 0 if the record was played back to its end tag.
+*/
+int main(int argc, char** argv)
+{
+    if(argc < 2) {
+        fprintf(stderr, "usage: %s record.bin [-q]\n", argv[0]);
+        return 2;
+    }
+    FILE* file = fopen(argv[1], "rb");
+    if(file == NULL) {
+        perror(argv[1]);
+        return 2;
+    }
+    uint8_t record[PLAYER_MAX_RECORD];
+    uint16_t size = fread(record, 1, sizeof(record), file);
+    fclose(file);
+    bool quiet = argc > 2 && strcmp(argv[2], "-q") == 0;
+
+    ReplaySummary_t summary = replay_play(record, size, PLAYER_FRAME_TICKS, quiet ? NULL : stdout);
+
+    uint64_t start = now_ns();
+    for(uint16_t i = 0; i < PLAYER_REPEATS; i++) {
+        replay_play(record, size, PLAYER_FRAME_TICKS, NULL);
+    }
+    double frameTime = (double)(now_ns() - start) / ((double)PLAYER_REPEATS * (summary.frames > 0 ? summary.frames : 1));
+
+    printf("%lu frames over %u rounds, %u balls recieved, score %u-%u, %u bytes%s, state hash %08lx, %.1f ns/frame (%.0fx real time)\n",
+        (unsigned long)summary.frames, summary.rounds, summary.balls, summary.score, summary.opponentScore, summary.length,
+        summary.complete ? "" : " (cut short)", (unsigned long)summary.stateHash, frameTime, 1e9 / PLAYER_FRAME_RATE / frameTime);
+    return summary.complete ? 0 : 1;
+}
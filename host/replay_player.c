@@ -0,0 +1,166 @@
+/** @file replay_player.c
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Plays a match recorded by replay.c back through the physics on the host, faster than real time.
+*/
+
+#include "replay_player.h"
+#include "replay.h"
+
+/* FNV-1a, over each field so padding in the state isn't hashed. */
+#define HASH_PRIME 16777619UL
+
+/** Adds a byte to a running hash.
+ * @param hash The hash so far.
+ * @param data The byte.
+ * @return The hash including the byte.
+*/
+static uint32_t hash_byte(uint32_t hash, uint8_t data)
+{
+    return (hash ^ data) * HASH_PRIME;
+}
+
+/** Adds a physics state to a running hash of states.
+ * @param hash The hash of the states so far.
+ * @param state The next state.
+ * @return The hash including the state.
+*/
+uint32_t replay_state_hash(uint32_t hash, const PhysicsState_t* state)
+{
+    hash = hash_byte(hash, state->ballActive | state->ballExitBack << 1 | state->gameOver << 2 | state->paddleBoost << 3);
+    hash = hash_byte(hash, (uint16_t)state->ballPosR & 0xFF);
+    hash = hash_byte(hash, (uint16_t)state->ballPosR >> 8);
+    hash = hash_byte(hash, (uint16_t)state->ballPosC & 0xFF);
+    hash = hash_byte(hash, (uint16_t)state->ballPosC >> 8);
+    hash = hash_byte(hash, state->ballVelR);
+    hash = hash_byte(hash, state->ballVelC);
+    hash = hash_byte(hash, state->paddleC);
+    hash = hash_byte(hash, state->paddleR);
+    hash = hash_byte(hash, state->paddleForwardTicks);
+    hash = hash_byte(hash, state->tickAccumulator & 0xFF);
+    return hash_byte(hash, state->tickAccumulator >> 8);
+}
+
+/** Prints the ball and score after an event.
+ * @param trace Where to print.
+ * @param summary The match so far.
+ * @param event What happened.
+*/
+static void replay_trace(FILE* trace, const ReplaySummary_t* summary, const char* event)
+{
+    if(trace == NULL) {
+        return;
+    }
+    fprintf(trace, "frame %6lu: %-18s ball %s at row %4d col %4d moving %3d,%3d, score %u-%u\n", (unsigned long)summary->frames, event,
+        summary->state.ballActive ? "here" : "away", summary->state.ballPosR, summary->state.ballPosC, summary->state.ballVelR,
+        summary->state.ballVelC, summary->score, summary->opponentScore);
+}
+
+/** Plays a recorded match back through the physics.
+ * @param record The record, as read from eeprom.
+ * @param size The number of bytes in record, the record ends at the end tag or if it runs past them.
+ * @param frameTicks The timer ticks in a frame of the funkit that recorded the match, recieved balls are moved on by their hop frames of these.
+ * @param trace If not NULL each event is printed to it, with the ball and score after it.
+ * @return The summary of the match, complete is false if the record was cut short.
+*/
+ReplaySummary_t replay_play(const uint8_t* record, uint16_t size, uint16_t frameTicks, FILE* trace)
+{
+    ReplaySummary_t summary = {
+        .frames = 0,
+        .rounds = 0,
+        .balls = 0,
+        .score = 0,
+        .opponentScore = 0,
+        .length = 0,
+        .complete = false,
+        .stateHash = REPLAY_HASH_INIT,
+        .state = physics_init(false)
+    };
+    /* Whether the physics is running, as in game.c it runs from a game start until the round ends. */
+    bool active = false;
+    uint16_t elapsed = 0;
+    uint16_t i = 0;
+
+    while(i < size) {
+        uint8_t tag = record[i++];
+        uint8_t frames = 1;
+        uint8_t inputs = 0;
+
+        if(tag == REPLAY_TAG_END) {
+            summary.complete = true;
+            break;
+        } else if(tag < REPLAY_RUN_MAX) {
+            frames = tag + 1;
+        } else if((tag & REPLAY_TAG_KIND_MASK) == REPLAY_TAG_INPUT) {
+            inputs = tag & REPLAY_TAG_INPUT_MASK;
+        } else if((tag & REPLAY_TAG_KIND_MASK) == REPLAY_TAG_DELTA) {
+            if(i + 1 > size) {
+                break;
+            }
+            inputs = tag & REPLAY_TAG_INPUT_MASK;
+            elapsed += (int8_t)record[i++];
+        } else if((tag & REPLAY_TAG_KIND_MASK) == REPLAY_TAG_ELAPSED) {
+            if(i + 2 > size) {
+                break;
+            }
+            inputs = tag & REPLAY_TAG_INPUT_MASK;
+            elapsed = record[i] | record[i + 1] << 8;
+            i += 2;
+        } else {
+            bool flag = tag & 1;
+            uint8_t kind = (tag >> 1) & 0x07;
+            if(kind == REPLAY_EVENT_START_GAME) {
+                summary.state = physics_init(flag);
+                summary.rounds++;
+                active = true;
+                elapsed = 0;
+                replay_trace(trace, &summary, flag ? "start with ball" : "start");
+            } else if(kind == REPLAY_EVENT_BALL) {
+                if(i + REPLAY_BALL_LENGTH > size) {
+                    break;
+                }
+                PhysicsPos_t ballPosR = (int16_t)(record[i] | record[i + 1] << 8);
+                summary.state = physics_receive_ball(summary.state, ballPosR, (int8_t)record[i + 2], (int8_t)record[i + 3], flag,
+                    record[i + 4] * frameTicks);
+                i += REPLAY_BALL_LENGTH;
+                summary.balls++;
+                replay_trace(trace, &summary, flag ? "ball over back" : "ball");
+            } else if(kind == REPLAY_EVENT_END_ROUND || kind == REPLAY_EVENT_GAME_OVER) {
+                /* Scored as game.c does, a relay counts the player behind as its opponent. */
+                summary.state.gameOver = true;
+                active = false;
+                if(flag) {
+                    summary.opponentScore++;
+                } else {
+                    summary.score++;
+                }
+                replay_trace(trace, &summary, kind == REPLAY_EVENT_END_ROUND ? "other side missed" : "game over");
+            } else {
+                /* Not a record replay.c writes, the record is corrupt from here. */
+                break;
+            }
+            summary.length = i;
+            continue;
+        }
+
+        Input_t input = {
+            .north = inputs & REPLAY_INPUT_NORTH,
+            .south = inputs & REPLAY_INPUT_SOUTH,
+            .west = inputs & REPLAY_INPUT_WEST,
+            .east = inputs & REPLAY_INPUT_EAST,
+            .push = inputs & REPLAY_INPUT_PUSH
+        };
+        for(uint8_t frame = 0; frame < frames && active; frame++) {
+            summary.state = physics_update(summary.state, input, elapsed);
+            summary.stateHash = replay_state_hash(summary.stateHash, &summary.state);
+            summary.frames++;
+            if(summary.state.gameOver) {
+                active = false;
+                summary.opponentScore++;
+                replay_trace(trace, &summary, "missed");
+            }
+        }
+        summary.length = i;
+    }
+
+    return summary;
+}
@@ -0,0 +1,46 @@
+/** @file replay_player.h
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Plays a match recorded by replay.c back through the physics on the host, faster than real time.
+*/
+
+#ifndef REPLAY_PLAYER_H
+#define REPLAY_PLAYER_H
+
+#include "system.h"
+#include "physics.h"
+#include <stdio.h>
+
+/* What a played back match came to. stateHash covers the physics state after every frame, so two runs of a match that desync anywhere
+    give different hashes, see replay_state_hash. */
+typedef struct {
+    uint32_t frames;
+    uint16_t rounds;
+    uint16_t balls;
+    uint8_t score;
+    uint8_t opponentScore;
+    uint16_t length;
+    bool complete;
+    uint32_t stateHash;
+    PhysicsState_t state;
+} ReplaySummary_t;
+
+/* The hash of no frames. */
+#define REPLAY_HASH_INIT 2166136261UL
+
+/** Adds a physics state to a running hash of states.
+ * @param hash The hash of the states so far.
+ * @param state The next state.
+ * @return The hash including the state.
+*/
+uint32_t replay_state_hash(uint32_t hash, const PhysicsState_t* state);
+
+/** Plays a recorded match back through the physics.
+ * @param record The record, as read from eeprom.
+ * @param size The number of bytes in record, the record ends at the end tag or if it runs past them.
+ * @param frameTicks The timer ticks in a frame of the funkit that recorded the match, recieved balls are moved on by their hop frames of these.
+ * @param trace If not NULL each event is printed to it, with the ball and score after it.
+ * @return The summary of the match, complete is false if the record was cut short.
+*/
+ReplaySummary_t replay_play(const uint8_t* record, uint16_t size, uint16_t frameTicks, FILE* trace);
+
+#endif //REPLAY_PLAYER_H
\ No newline at end of file
@@ -0,0 +1,16 @@
+/** @file system.h
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Host stand in for the funkit system header, so the game modules can be built and benchmarked on a pc.
+*/
+
+#ifndef SYSTEM_H
+#define SYSTEM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define F_CPU 8000000
+
+#define BIT(X) (1 << (X))
+
+#endif //SYSTEM_H
\ No newline at end of file
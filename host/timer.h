@@ -0,0 +1,17 @@
+/** @file timer.h
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Host stand in for the funkit timer driver, only the tick rate and type are needed off-device.
+*/
+
+#ifndef TIMER_H
+#define TIMER_H
+
+#include "system.h"
+
+/* Matches the funkit timer driver, timer 1 clocked at F_CPU / 1024. */
+#define TIMER_CLOCK_DIVISOR 1024
+#define TIMER_RATE (F_CPU / TIMER_CLOCK_DIVISOR)
+
+typedef uint16_t timer_tick_t;
+
+#endif //TIMER_H
\ No newline at end of file
@@ -0,0 +1,78 @@
+/** @file idle.c
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Paces the main loop with the cpu asleep between frames, and can sleep through frames until there is input or ir data.
+*/
+
+#include "idle.h"
+#include "timer.h"
+#include "ir_queue.h"
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+
+/* The navswitch north, south, push and west pins (PC6, PC5, PC4 and PC2, see target.h) have pin change interrupts, east (PC7) doesn't
+    so a push east alone doesn't end a wait for an event, it is seen at the next frame with something to do. */
+#define NAVSWITCH_PCINT_MASK (BIT(PCINT8) | BIT(PCINT9) | BIT(PCINT10) | BIT(PCINT11))
+
+static timer_tick_t period;
+/* The time the next frame is due, the compare B register is set to it so the timer wakes the cpu on time. */
+static timer_tick_t frameTime;
+/* Set by a navswitch pin change. */
+static volatile bool navswitchChanged = false;
+
+/* Timer 1 compare B interrupt, there is nothing to do but wake the cpu for the frame. */
+EMPTY_INTERRUPT(TIMER1_COMPB_vect);
+
+/* Pin change interrupt 1, a navswitch pin has changed. */
+ISR(PCINT1_vect)
+{
+    navswitchChanged = true;
+}
+
+/** Starts pacing frames at a fixed rate, the first frame is due a period from now. Timer 1 must already be running, see ledscan_init.
+ * @param rate The frame rate in Hz.
+*/
+void idle_init(uint16_t rate)
+{
+    period = TIMER_RATE / rate;
+    frameTime = timer_get();
+    navswitchChanged = false;
+    PCMSK1 |= NAVSWITCH_PCINT_MASK;
+    PCICR |= BIT(PCIE1);
+    TIFR1 = BIT(OCF1B);
+    TIMSK1 |= BIT(OCIE1B);
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    sei();
+}
+
+/** Sleeps until the next frame is due, waking for each interrupt in the meantime.
+ * @param untilEvent If true, frames with nothing to do are slept through too, until the navswitch changes or a byte is recieved over ir.
+*/
+void idle_wait(bool untilEvent)
+{
+    /* A frame that overran by more than a period is not caught up, the next frame is due a period after it. */
+    timer_tick_t now = timer_get();
+    if((timer_tick_t)(now - frameTime) >= period) {
+        frameTime = now;
+    }
+    frameTime += period;
+    OCR1B = frameTime;
+
+    while(1) {
+        /* Interrupts are disabled between checking the time and sleeping, the instruction after sei is always run before an interrupt
+            so one can't slip in between and leave the cpu asleep past the frame. The ledscan and ir interrupts wake it meanwhile. */
+        cli();
+        if((timer_tick_t)(timer_get() - frameTime) < period) {
+            if(!untilEvent || navswitchChanged || ir_queue_read_ready_p()) {
+                navswitchChanged = false;
+                sei();
+                return;
+            }
+            frameTime += period;
+            OCR1B = frameTime;
+        }
+        sleep_enable();
+        sei();
+        sleep_cpu();
+        sleep_disable();
+    }
+}
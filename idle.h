@@ -0,0 +1,21 @@
+/** @file idle.h
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Paces the main loop with the cpu asleep between frames, and can sleep through frames until there is input or ir data.
+*/
+
+#ifndef IDLE_H
+#define IDLE_H
+
+#include "system.h"
+
+/** Starts pacing frames at a fixed rate, the first frame is due a period from now. Timer 1 must already be running, see ledscan_init.
+ * @param rate The frame rate in Hz.
+*/
+void idle_init(uint16_t rate);
+
+/** Sleeps until the next frame is due, waking for each interrupt in the meantime.
+ * @param untilEvent If true, frames with nothing to do are slept through too, until the navswitch changes or a byte is recieved over ir.
+*/
+void idle_wait(bool untilEvent);
+
+#endif //IDLE_H
\ No newline at end of file
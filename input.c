@@ -0,0 +1,30 @@
+/** @file input.c
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Samples the navswitch once per frame into an input snapshot shared by the other modules.
+*/
+
+#include "input.h"
+#include "navswitch.h"
+
+/** Initializes the navswitch. */
+void input_init(void)
+{
+    navswitch_init();
+}
+
+/** Scans the navswitch, should be called exactly once per frame so no push event is seen twice or missed.
+ * @return The push events since the last call.
+*/
+Input_t input_update(void)
+{
+    navswitch_update();
+
+    Input_t input = {
+        .north = navswitch_push_event_p(NAVSWITCH_NORTH),
+        .south = navswitch_push_event_p(NAVSWITCH_SOUTH),
+        .west = navswitch_push_event_p(NAVSWITCH_WEST),
+        .east = navswitch_push_event_p(NAVSWITCH_EAST),
+        .push = navswitch_push_event_p(NAVSWITCH_PUSH)
+    };
+    return input;
+}
@@ -0,0 +1,28 @@
+/** @file input.h
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Samples the navswitch once per frame into an input snapshot shared by the other modules.
+*/
+
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "system.h"
+
+/* The navswitch push events that happened since the last frame. */
+typedef struct {
+    bool north;
+    bool south;
+    bool west;
+    bool east;
+    bool push;
+} Input_t;
+
+/** Initializes the navswitch. */
+void input_init(void);
+
+/** Scans the navswitch, should be called exactly once per frame so no push event is seen twice or missed.
+ * @return The push events since the last call.
+*/
+Input_t input_update(void);
+
+#endif //INPUT_H
\ No newline at end of file
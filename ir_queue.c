@@ -0,0 +1,127 @@
+/** @file ir_queue.c
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Interrupt driven receive and transmit buffers for the ir channel.
+*/
+
+#include "ir_queue.h"
+#include "ir_uart.h"
+#include <avr/interrupt.h>
+
+#define RX_MASK (IR_QUEUE_RX_SIZE - 1)
+#define TX_MASK (IR_QUEUE_TX_SIZE - 1)
+
+/* Single producer/single consumer ring buffer: the receive interrupt is the only writer of rxHead and the main loop is the only writer of rxTail,
+    so no locking is needed as single byte accesses are atomic. One slot is always left empty to tell a full buffer from an empty one. */
+static volatile uint8_t rxBuffer[IR_QUEUE_RX_SIZE];
+static volatile uint8_t rxHead = 0;
+static volatile uint8_t rxTail = 0;
+static volatile uint8_t rxDropped = 0;
+
+/* The transmit buffer works the same way, the main loop writes txHead and the data register empty interrupt writes txTail. */
+static volatile uint8_t txBuffer[IR_QUEUE_TX_SIZE];
+static volatile uint8_t txHead = 0;
+static volatile uint8_t txTail = 0;
+
+/* Receive complete interrupt, moves the byte from the uart into the ring buffer. */
+ISR(USART1_RX_vect)
+{
+    /* The status flags must be read before the data register. */
+    bool error = (UCSR1A & (BIT(FE1) | BIT(DOR1))) != 0;
+    uint8_t data = UDR1;
+    uint8_t next = (rxHead + 1) & RX_MASK;
+
+    if(error || next == rxTail) {
+        if(rxDropped < UINT8_MAX) {
+            rxDropped++;
+        }
+        return;
+    }
+
+    rxBuffer[rxHead] = data;
+    rxHead = next;
+}
+
+/* Data register empty interrupt, hands the next queued byte to the uart and disables itself once the buffer is empty. */
+ISR(USART1_UDRE_vect)
+{
+    if(txHead == txTail) {
+        UCSR1B &= ~BIT(UDRIE1);
+        return;
+    }
+
+    UDR1 = txBuffer[txTail];
+    txTail = (txTail + 1) & TX_MASK;
+}
+
+/** Initializes the ir uart and enables the receive interrupt, which fills the receive buffer as bytes arrive, the transmit interrupt is enabled as bytes are queued. */
+void ir_queue_init(void)
+{
+    ir_uart_init();
+    rxHead = 0;
+    rxTail = 0;
+    rxDropped = 0;
+    txHead = 0;
+    txTail = 0;
+    UCSR1B |= BIT(RXCIE1);
+    sei();
+}
+
+/** Checks if there is a byte waiting in the receive buffer.
+ * @return True if ir_queue_getc will return a byte.
+*/
+bool ir_queue_read_ready_p(void)
+{
+    return rxHead != rxTail;
+}
+
+/** Takes the oldest byte from the receive buffer, should only be called if ir_queue_read_ready_p is true.
+ * @return The oldest recieved byte.
+*/
+uint8_t ir_queue_getc(void)
+{
+    uint8_t data = rxBuffer[rxTail];
+    rxTail = (rxTail + 1) & RX_MASK;
+    return data;
+}
+
+/** The number of bytes that can currently be queued for transmission.
+ * @return The free space in the transmit buffer.
+*/
+uint8_t ir_queue_write_space(void)
+{
+    return (txTail - txHead - 1) & TX_MASK;
+}
+
+/** Queues a byte to be sent over the ir channel by the transmit interrupt, returning immediately.
+ * @param data The byte to send.
+ * @return False if the transmit buffer is full and the byte was not queued.
+*/
+bool ir_queue_putc(uint8_t data)
+{
+    uint8_t next = (txHead + 1) & TX_MASK;
+    if(next == txTail) {
+        return false;
+    }
+
+    txBuffer[txHead] = data;
+    txHead = next;
+    /* The interrupt may have just disabled itself, it is always safe to enable it again as it checks for an empty buffer. */
+    UCSR1B |= BIT(UDRIE1);
+    return true;
+}
+
+/** Checks if every queued byte has been handed to the uart.
+ * @return True if the transmit buffer is empty.
+*/
+bool ir_queue_write_empty_p(void)
+{
+    return txHead == txTail;
+}
+
+/** The number of bytes dropped because the receive buffer was full or the uart reported an error.
+ * @return The dropped byte count, saturating at 255.
+*/
+uint8_t ir_queue_dropped(void)
+{
+    return rxDropped;
+}
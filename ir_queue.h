@@ -0,0 +1,51 @@
+/** @file ir_queue.h
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Interrupt driven receive and transmit buffers for the ir channel.
+*/
+
+#ifndef IR_QUEUE_H
+#define IR_QUEUE_H
+
+#include "system.h"
+
+/* Number of bytes the receive buffer can hold, must be a power of two so the indexes can wrap with a mask. */
+#define IR_QUEUE_RX_SIZE 16
+/* Number of bytes the transmit buffer can hold, must be a power of two. Kept small as each queued byte adds about 4ms of latency at the ir baud rate,
+    but must hold the longest encoded frame (FRAME_MAX_LENGTH), as frames are only queued whole. */
+#define IR_QUEUE_TX_SIZE 32
+
+/** Initializes the ir uart and enables the receive interrupt, which fills the receive buffer as bytes arrive, the transmit interrupt is enabled as bytes are queued. */
+void ir_queue_init(void);
+
+/** Checks if there is a byte waiting in the receive buffer.
+ * @return True if ir_queue_getc will return a byte.
+*/
+bool ir_queue_read_ready_p(void);
+
+/** Takes the oldest byte from the receive buffer, should only be called if ir_queue_read_ready_p is true.
+ * @return The oldest recieved byte.
+*/
+uint8_t ir_queue_getc(void);
+
+/** The number of bytes that can currently be queued for transmission.
+ * @return The free space in the transmit buffer.
+*/
+uint8_t ir_queue_write_space(void);
+
+/** Queues a byte to be sent over the ir channel by the transmit interrupt, returning immediately.
+ * @param data The byte to send.
+ * @return False if the transmit buffer is full and the byte was not queued.
+*/
+bool ir_queue_putc(uint8_t data);
+
+/** Checks if every queued byte has been handed to the uart.
+ * @return True if the transmit buffer is empty.
+*/
+bool ir_queue_write_empty_p(void);
+
+/** The number of bytes dropped because the receive buffer was full or the uart reported an error.
+ * @return The dropped byte count, saturating at 255.
+*/
+uint8_t ir_queue_dropped(void);
+
+#endif //IR_QUEUE_H
\ No newline at end of file
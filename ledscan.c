@@ -0,0 +1,92 @@
+/** @file ledscan.c
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Refreshes the led matrix from a timer interrupt, so the game can draw at its own rate, with a few levels of brightness per led.
+*/
+
+#include "ledscan.h"
+#include "ledmat.h"
+#include "timer.h"
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+/* Timer ticks between columns. Timer 1 is left free running for idle_wait, so the compare register is advanced each interrupt rather than resetting the count. */
+#define LEDSCAN_PERIOD (TIMER_RATE / LEDSCAN_COLUMN_RATE)
+/* Timer ticks per unit of binary coded modulation. The column's time is split between its planes rather than added to, so the column rate
+    is unchanged, the top plane takes the ticks left over from rounding which makes it slightly brighter than twice the plane below. */
+#define LEDSCAN_UNIT (LEDSCAN_PERIOD / LEDSCAN_MAX_LEVEL)
+
+/* The compare register is advanced from the time it was due, an interrupt delayed by more than a unit would wait for the timer to wrap. */
+_Static_assert(LEDSCAN_UNIT >= 2, "too many planes to fit in a column");
+
+static const uint8_t blank[LEDSCAN_NUM_PLANES * LEDSCAN_NUM_COLS] = {0x00};
+/* The buffer being displayed, only changed with interrupts disabled. */
+static const uint8_t* volatile front = blank;
+static uint8_t column = 0;
+static uint8_t plane = 0;
+/* The pattern last written to the matrix. */
+static uint8_t lastPattern = 0x00;
+
+/* Timer 1 compare A interrupt, displays the next plane of the column, or the next column. */
+ISR(TIMER1_COMPA_vect)
+{
+    const uint8_t* planes = front + column;
+    uint8_t pattern = planes[plane * LEDSCAN_NUM_COLS];
+    uint8_t ticks;
+
+    if(plane == LEDSCAN_NUM_PLANES - 1) {
+        ticks = LEDSCAN_PERIOD - (BIT(plane) - 1) * LEDSCAN_UNIT;
+    } else {
+        ticks = LEDSCAN_UNIT << plane;
+    }
+    if(plane == 0) {
+        /* A column lit the same in every plane, as the score and paddle are, is shown once for the whole of its time,
+            so only columns with a dimmed led take more than one interrupt. */
+        bool uniform = true;
+        for(uint8_t p = 1; p < LEDSCAN_NUM_PLANES; p++) {
+            if(planes[p * LEDSCAN_NUM_COLS] != pattern) {
+                uniform = false;
+            }
+        }
+        if(uniform) {
+            ticks = LEDSCAN_PERIOD;
+            plane = LEDSCAN_NUM_PLANES - 1;
+        }
+    }
+    OCR1A += ticks;
+
+    /* A blank column after a blank column needs no port writes, the rows are already all off so which column is driven doesn't matter. */
+    if(pattern != 0x00 || lastPattern != 0x00) {
+        ledmat_display_column(pattern, column);
+        lastPattern = pattern;
+    }
+    plane++;
+    if(plane == LEDSCAN_NUM_PLANES) {
+        plane = 0;
+        column = (column + 1) % LEDSCAN_NUM_COLS;
+    }
+}
+
+/** Initializes the led matrix and starts the refresh interrupt, with the display blank. */
+void ledscan_init(void)
+{
+    ledmat_init();
+    timer_init();
+    front = blank;
+    column = 0;
+    plane = 0;
+    lastPattern = 0x00;
+    OCR1A = timer_get() + LEDSCAN_PERIOD;
+    TIFR1 = BIT(OCF1A);
+    TIMSK1 |= BIT(OCIE1A);
+    sei();
+}
+
+/** Atomically changes the buffer being displayed. The buffer must not be written until another buffer is shown in its place.
+ * @param buffer LEDSCAN_NUM_PLANES planes of LEDSCAN_NUM_COLS column bitmasks to display, plane 0 first.
+*/
+void ledscan_show(const uint8_t* buffer)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        front = buffer;
+    }
+}
@@ -0,0 +1,27 @@
+/** @file ledscan.h
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Refreshes the led matrix from a timer interrupt, so the game can draw at its own rate, with a few levels of brightness per led.
+*/
+
+#ifndef LEDSCAN_H
+#define LEDSCAN_H
+
+#include "system.h"
+
+#define LEDSCAN_NUM_COLS 5
+/* Each column is displayed in turn at this rate, so the whole display is refreshed at LEDSCAN_COLUMN_RATE / LEDSCAN_NUM_COLS. */
+#define LEDSCAN_COLUMN_RATE 250
+/* Each column is shown as LEDSCAN_NUM_PLANES bit planes with binary coded modulation, plane n is lit for 2^n units of the column's time,
+    so a led lit in some of the planes glows at the sum of their weights out of LEDSCAN_MAX_LEVEL. */
+#define LEDSCAN_NUM_PLANES 3
+#define LEDSCAN_MAX_LEVEL (BIT(LEDSCAN_NUM_PLANES) - 1)
+
+/** Initializes the led matrix and starts the refresh interrupt, with the display blank. */
+void ledscan_init(void);
+
+/** Atomically changes the buffer being displayed. The buffer must not be written until another buffer is shown in its place.
+ * @param buffer LEDSCAN_NUM_PLANES planes of LEDSCAN_NUM_COLS column bitmasks to display, plane 0 first.
+*/
+void ledscan_show(const uint8_t* buffer);
+
+#endif //LEDSCAN_H
\ No newline at end of file
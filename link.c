@@ -0,0 +1,661 @@
+/** @file link.c
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Reliable sliding window link over the ir channel, carrying typed messages in frames with cumulative and selective acknowledgements.
+    Each frame is addressed to a seam of the court (see geometry.h), and a relay board keeps a separate link with the board on each side.
+*/
+
+#include "link.h"
+#include "ir_queue.h"
+
+/* The first payload byte of every link frame is a header. Message frames hold their sequence number in the low bits, followed by the message
+    type and data. A message the sender has held for some frames, as it is a retransmission or waited for room, has LINK_HELD_FLAG set and
+    the held count after the type, so a message sent straight away costs no extra byte. Acknowledgement frames have LINK_ACK_FLAG set, followed
+    by the cumulative ack (the first sequence number not yet recieved), and a bitmask of the messages after it that have been recieved out of
+    order, bit 0 being the message after the cumulative ack. An ack has no sequence number of its own, so the sender's shared frame (see
+    link_frame) rides in the bits the sequence number takes in the header, which hold its top bits, and above the cumulative ack. Every header
+    holds the seam the frame crosses, only the two boards either side of a seam use it, so frames for other seams are ignored. */
+#define LINK_ACK_FLAG 0x10
+#define LINK_HELD_FLAG 0x08
+#define SEAM_SHIFT 5
+#define SEAM_MASK (0x03 << SEAM_SHIFT)
+#define SEQ_MASK 0x07
+#define SEQ_NUMBER_LIMIT (SEQ_MASK + 1)
+#define SLOT_MASK (LINK_WINDOW_SIZE - 1)
+#define MESSAGE_HEADER_LENGTH 2
+#define ACK_PAYLOAD_LENGTH 3
+#define ACK_FRAME_LOW_SHIFT 3
+#define ACK_FRAME_HIGH_SHIFT (8 - ACK_FRAME_LOW_SHIFT)
+/* The number of frames to wait for an acknowledgement before retransmitting is the smoothed round trip plus its mean deviation,
+    which is kept for each link from the acks of messages sent once. It starts at LINK_RETRANSMIT_FRAMES, long enough for a frame and its ack
+    to both be sent on a quiet channel, and is kept between the limits so a run of slow acks can't stall the link. As only the acks of
+    messages sent once are timed, a timeout shorter than the round trip would resend every message and never be corrected, so as in TCP a
+    timer running out doubles the timeout, up to LINK_MAX_TIMEOUT_DOUBLINGS times, until the next message sent once is timed. The doubling
+    is also undone by the ack of a resent message coming at least LINK_MIN_RETRANSMIT_FRAMES after the resend, as that ack is most likely
+    for the resend, so the first copy was lost rather than late. Random loss would otherwise keep every link that needs it most backed off. */
+#define LINK_RETRANSMIT_FRAMES 5
+#define LINK_MIN_RETRANSMIT_FRAMES 2
+#define LINK_MAX_RETRANSMIT_FRAMES 16
+#define LINK_MAX_TIMEOUT_DOUBLINGS 1
+/* A frame queued behind others is on the air that much later, so its timer also waits out the bytes ahead of it in the transmit buffer, at
+    the bytes sent each frame: 2400 baud with a start and stop bit is 4.8 bytes a frame at 50 frames a second, rounded down to wait longer. */
+#define LINK_AIR_BYTES_PER_FRAME 4
+/* The smoothed round trip is kept in eighths of a frame and the deviation in quarters, so each sample moves them an eighth and a quarter of
+    the way to it with shifts. */
+#define SRTT_SHIFT 3
+#define RTTVAR_SHIFT 2
+/* Each message acknowledged moves the loss estimate 1/2^LOSS_SHIFT of the way to LINK_MAX_LOSS if it had to be retransmitted, or to 0. */
+#define LOSS_SHIFT 3
+#define LOSS_STEP (LINK_MAX_LOSS >> LOSS_SHIFT)
+/* On a court of three or more boards a frame is lost when two boards are heard at once, two boards retransmitting on the same timer would be
+    lost together every time, and a window of retransmissions could keep every board on the air at once. So on top of the timeout,
+    retransmissions wait a pseudo random number of frames longer, up to one less than LINK_BACKOFF_FRAMES doubled for each earlier
+    retransmission of the message, at most LINK_MAX_BACKOFF_DOUBLINGS times. Two boards only hear each other, so they retransmit on the timer alone. */
+#if GEOMETRY_BOARDS > 2
+#define LINK_BACKOFF_FRAMES 4
+#else
+#define LINK_BACKOFF_FRAMES 0
+#endif
+#define LINK_MAX_BACKOFF_DOUBLINGS 2
+/* Once more than LINK_DUPLICATE_LOSS of the messages on a link have needed retransmitting (see link_loss), each new message is sent again a
+    frame after the first time without waiting for its timer. This costs airtime, but saves a whole timeout whenever the first copy is lost.
+    A court of three or more boards backs off instead, as the extra frames would collide, 0 turns duplication off. */
+#if GEOMETRY_BOARDS > 2
+#define LINK_DUPLICATE_LOSS 0
+#else
+#define LINK_DUPLICATE_LOSS (LINK_MAX_LOSS / 2)
+#endif
+
+/* The shared frame counter is kept in 1/65536ths of a frame. The acknowledgement of a message sent once stamps the other funkit's counter
+    between our sending the message and hearing the ack, so as in NTP our counter halfway through the round trip is compared to it. Each funkit
+    moves its counter a quarter of the way to the other's on each sample, half on its first, so the two meet in the middle without overshooting,
+    and a delay that is longer one way than the other moves both counters together rather than apart. A funkit whose timer runs fast or slow
+    is followed by the same steps, as the error it builds between samples is small. The rate isn't corrected as well: both funkits would see
+    the uneven delay as the other running fast, and speed up together until one reached its limit. */
+#define CLOCK_ONE_FRAME 0x10000L
+#define CLOCK_HALF_FRAME (CLOCK_ONE_FRAME / 2)
+#define CLOCK_PHASE_DIVISOR 4
+#define CLOCK_FIRST_PHASE_DIVISOR 2
+
+/* One slot of the transmit buffer is always empty, so a frame of FRAME_MAX_LENGTH must fit in the rest or it could never be queued. */
+#if FRAME_MAX_LENGTH >= IR_QUEUE_TX_SIZE
+#error "IR_QUEUE_TX_SIZE is too small to hold a frame"
+#endif
+#if SEQ_NUMBER_LIMIT != BIT(ACK_FRAME_LOW_SHIFT)
+#error "the shared frame doesn't fill the bits of an ack's header and cumulative ack"
+#endif
+#if GEOMETRY_MAX_SEAM > (SEAM_MASK >> SEAM_SHIFT)
+#error "GEOMETRY_MAX_SEAM does not fit the link header"
+#endif
+
+/* A message waiting for its acknowledgement. The age is the frames since its first transmission, so its acknowledgement times the round trip,
+    and the message's held count is the frames since it was first offered to the transmit buffer, which is the first chance to send it. The
+    timer start is what the retransmission timer was set to when the message was last sent, so the frames since then can be told.
+    A duplicated message has its second copy sent early on a lossy link, see LINK_DUPLICATE_LOSS, which isn't counted as a retransmission. */
+typedef struct {
+    LinkMessage_t message;
+    bool acked;
+    bool offered;
+    bool sent;
+    bool duplicated;
+    bool duplicatePending;
+    uint8_t retransmits;
+    uint8_t retransmitTicks;
+    uint8_t timerStart;
+    uint8_t age;
+} LinkSendSlot_t;
+
+/* The link with one other funkit. */
+typedef struct {
+    /* Sender: messages from sendBase up to (not including) sendNext are in the window. */
+    LinkSendSlot_t sendSlots[LINK_WINDOW_SIZE];
+    uint8_t sendBase;
+    uint8_t sendNext;
+    /* Reciever: messages from readSeq are buffered until read, recvNext is the first message not yet recieved (the cumulative ack). */
+    LinkMessage_t recvSlots[LINK_WINDOW_SIZE];
+    bool recvValid[LINK_WINDOW_SIZE];
+    uint8_t readSeq;
+    uint8_t recvNext;
+    bool ackPending;
+    /* The smoothed round trip in eighths of a frame, its mean deviation in quarters of a frame, the times the timeout has been doubled since
+        the last round trip was timed, and the share of messages retransmitted. */
+    uint8_t smoothedRoundTrip;
+    uint8_t roundTripDeviation;
+    uint8_t timeoutDoublings;
+    uint8_t loss;
+    LinkStats_t stats;
+} LinkPeer_t;
+
+static LinkPeer_t peers[LINK_NUM_PEERS];
+
+/* The shared frame counter, see CLOCK_ONE_FRAME. */
+static uint32_t sharedClock;
+static bool clockSynced;
+
+/* State of the pseudo random backoff, a 16 bit Galois LFSR seeded by the seam so the boards either side of a relay don't back off together. */
+static uint16_t backoffRandom;
+
+/** The distance from one sequence number to another, modulo the sequence number space.
+ * @param from The earlier sequence number.
+ * @param to The later sequence number.
+ * @return The number of messages between the two.
+*/
+static uint8_t seq_distance(uint8_t from, uint8_t to)
+{
+    return (to - from) & SEQ_MASK;
+}
+
+/** The header bits addressing frames to or from a funkit.
+ * @param peer The funkit.
+ * @return The seam between us in the header's seam bits.
+*/
+static uint8_t peer_seam_bits(uint8_t peer)
+{
+    return (uint8_t)((GEOMETRY_SEAM + peer) << SEAM_SHIFT);
+}
+
+/** Chooses the extra frames a retransmission waits.
+ * @param retransmits The number of times the message has been retransmitted, including this time.
+ * @return The backoff in frames.
+*/
+static uint8_t link_backoff(uint8_t retransmits)
+{
+    uint8_t doublings = retransmits - 1;
+    if(doublings > LINK_MAX_BACKOFF_DOUBLINGS) {
+        doublings = LINK_MAX_BACKOFF_DOUBLINGS;
+    }
+    backoffRandom = (backoffRandom >> 1) ^ (-(backoffRandom & 1) & 0xB400);
+    /* The backoff is a power of two, so the range is taken with a mask. */
+    return backoffRandom & ((LINK_BACKOFF_FRAMES << doublings) - 1);
+}
+
+/** Initializes the link, clearing all sequence numbers and buffers. Both funkits must initialize together. */
+void link_init(void)
+{
+    backoffRandom = 0xACE1 ^ (GEOMETRY_SEAM << 8);
+    sharedClock = 0;
+    clockSynced = false;
+    for(uint8_t peer = 0; peer < LINK_NUM_PEERS; peer++) {
+        LinkPeer_t* link = &peers[peer];
+        link->sendBase = 0;
+        link->sendNext = 0;
+        link->readSeq = 0;
+        link->recvNext = 0;
+        link->ackPending = false;
+        link->smoothedRoundTrip = LINK_RETRANSMIT_FRAMES << SRTT_SHIFT;
+        link->roundTripDeviation = 0;
+        link->timeoutDoublings = 0;
+        link->loss = 0;
+        link->stats = (LinkStats_t){0};
+        for(uint8_t i = 0; i < LINK_WINDOW_SIZE; i++) {
+            link->sendSlots[i].acked = true;
+            link->recvValid[i] = false;
+        }
+    }
+}
+
+/** Queues a message to be reliably sent to another funkit.
+ * @param peer The funkit to send to, LINK_PEER_FRONT or LINK_PEER_BACK.
+ * @param type The type of the message.
+ * @param data The message data.
+ * @param length The number of bytes of data, at most LINK_MAX_MESSAGE.
+ * @return False if the window is full and the message was not queued.
+*/
+bool link_send(uint8_t peer, uint8_t type, const uint8_t* data, uint8_t length)
+{
+    LinkPeer_t* link = &peers[peer];
+    if(seq_distance(link->sendBase, link->sendNext) >= LINK_WINDOW_SIZE || length > LINK_MAX_MESSAGE) {
+        return false;
+    }
+
+    LinkSendSlot_t* slot = &link->sendSlots[link->sendNext & SLOT_MASK];
+    slot->message.type = type;
+    slot->message.length = length;
+    slot->message.held = 0;
+    for(uint8_t i = 0; i < length; i++) {
+        slot->message.data[i] = data[i];
+    }
+    slot->acked = false;
+    slot->offered = false;
+    slot->sent = false;
+    slot->duplicated = false;
+    slot->duplicatePending = false;
+    slot->retransmits = 0;
+    slot->retransmitTicks = 0;
+    slot->age = 0;
+    link->sendNext = (link->sendNext + 1) & SEQ_MASK;
+    return true;
+}
+
+/** Checks if every queued message to every funkit has been acknowledged.
+ * @return True if there are no messages waiting for an acknowledgement.
+*/
+bool link_idle_p(void)
+{
+    for(uint8_t peer = 0; peer < LINK_NUM_PEERS; peer++) {
+        if(peers[peer].sendBase != peers[peer].sendNext) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Checks if the link has nothing left to do until another frame is recieved, for sleeping through frames.
+ * @return True if every message has been acknowledged, every acknowledgement sent and every recieved message read.
+*/
+bool link_quiet_p(void)
+{
+    for(uint8_t peer = 0; peer < LINK_NUM_PEERS; peer++) {
+        if(peers[peer].ackPending || peers[peer].readSeq != peers[peer].recvNext) {
+            return false;
+        }
+    }
+    return link_idle_p();
+}
+
+/** The frames a link waits for an acknowledgement before retransmitting, see LINK_RETRANSMIT_FRAMES.
+ * @param link The link.
+ * @return The retransmission timeout in frames.
+*/
+static uint8_t link_timeout(const LinkPeer_t* link)
+{
+    uint16_t frames = ((link->smoothedRoundTrip + BIT(SRTT_SHIFT - 1)) >> SRTT_SHIFT) + (link->roundTripDeviation >> RTTVAR_SHIFT);
+    frames <<= link->timeoutDoublings;
+    if(frames < LINK_MIN_RETRANSMIT_FRAMES) {
+        return LINK_MIN_RETRANSMIT_FRAMES;
+    }
+    if(frames > LINK_MAX_RETRANSMIT_FRAMES) {
+        return LINK_MAX_RETRANSMIT_FRAMES;
+    }
+    return frames;
+}
+
+/** Marks a message as acknowledged, timing the round trip if it was only sent once, as the ack of a resent message could be for either copy,
+ * and updating the loss estimate.
+ * @param link The link the message was sent on.
+ * @param slot The message.
+ * @return The round trip in frames, or 0 if it couldn't be timed.
+*/
+static uint8_t link_acked(LinkPeer_t* link, LinkSendSlot_t* slot)
+{
+    if(slot->acked) {
+        return 0;
+    }
+    slot->acked = true;
+    link->stats.acked++;
+    if(!slot->sent) {
+        return 0;
+    }
+
+    /* The ack of a duplicated message is timed from its first copy, if it was later than the timeout the first copy was lost. */
+    bool lost = slot->retransmits > 0 || (slot->duplicated && slot->age >= link_timeout(link));
+    link->loss -= link->loss >> LOSS_SHIFT;
+    if(lost) {
+        link->loss += LOSS_STEP;
+        /* An ack soon after a resend is for the first copy, which was only late, a later one is likely for the resend, so the first copy was
+            lost, see LINK_MAX_TIMEOUT_DOUBLINGS. A duplicated message timed out from its first copy was lost either way. */
+        bool resendAcked = slot->retransmits > 0 && (uint8_t)(slot->timerStart - slot->retransmitTicks) >= LINK_MIN_RETRANSMIT_FRAMES;
+        if(resendAcked) {
+            link->timeoutDoublings = 0;
+        }
+        if(resendAcked || slot->retransmits == 0) {
+            link->stats.lost++;
+        }
+        return 0;
+    }
+
+    /* The ack is handled before this frame's link_update, so the round trip is a frame more than the age. The smoothed round trip moves an
+        eighth of the way to each sample and the deviation a quarter of the way to the difference, as in TCP, all in fixed point. With the
+        round trip timed the timeout comes from it again, rather than the doubled one. */
+    link->timeoutDoublings = 0;
+    uint8_t sample = slot->age + 1;
+    if(sample > LINK_MAX_RETRANSMIT_FRAMES) {
+        sample = LINK_MAX_RETRANSMIT_FRAMES;
+    }
+    int8_t error = sample - (link->smoothedRoundTrip >> SRTT_SHIFT);
+    link->smoothedRoundTrip += sample - (link->smoothedRoundTrip >> SRTT_SHIFT);
+    if(error < 0) {
+        error = -error;
+    }
+    link->roundTripDeviation += error - (link->roundTripDeviation >> RTTVAR_SHIFT);
+    return sample;
+}
+
+/** Moves the shared frame counter towards another funkit's, see CLOCK_ONE_FRAME.
+ * @param frame The other funkit's shared frame when it sent an acknowledgement.
+ * @param roundTrip The frames from sending the acknowledged message to hearing the acknowledgement.
+*/
+static void link_sync_clock(uint8_t frame, uint8_t roundTrip)
+{
+    /* Both counters are read after each frame's link_update, the ack is heard before it, so the round trip ended at our counter plus a frame.
+        The other funkit's counter was anywhere in the frame it stamped, so half a frame past it on average. */
+    int32_t error = (int32_t)(int8_t)(frame - (uint8_t)(sharedClock >> 16)) * CLOCK_ONE_FRAME - (int32_t)(sharedClock & 0xFFFF)
+        + CLOCK_HALF_FRAME - CLOCK_ONE_FRAME + (int32_t)roundTrip * CLOCK_HALF_FRAME;
+
+    sharedClock += error / (clockSynced ? CLOCK_PHASE_DIVISOR : CLOCK_FIRST_PHASE_DIVISOR);
+    clockSynced = true;
+}
+
+/** Handles an acknowledgement frame, releasing acknowledged messages from the window, and taking a clock sample from the quickest round trip
+ * it times, as that has the least room for the two ways to differ.
+ * @param link The link the acknowledgement was recieved on.
+ * @param cumulativeAck The first sequence number the other funkit has not recieved.
+ * @param selectiveAcks Bitmask of the messages after cumulativeAck that the other funkit has recieved.
+ * @param frame The other funkit's shared frame when it sent the acknowledgement.
+*/
+static void link_receive_ack(LinkPeer_t* link, uint8_t cumulativeAck, uint8_t selectiveAcks, uint8_t frame)
+{
+    /* Ignore acks for messages that aren't in the window, they are stale duplicates. */
+    uint8_t outstanding = seq_distance(link->sendBase, link->sendNext);
+    if(seq_distance(link->sendBase, cumulativeAck) > outstanding) {
+        return;
+    }
+
+    uint8_t roundTrip = UINT8_MAX;
+    while(link->sendBase != cumulativeAck) {
+        uint8_t sample = link_acked(link, &link->sendSlots[link->sendBase & SLOT_MASK]);
+        if(sample > 0 && sample < roundTrip) {
+            roundTrip = sample;
+        }
+        link->sendBase = (link->sendBase + 1) & SEQ_MASK;
+    }
+
+    /* Mark messages recieved out of order so they aren't resent. Any earlier message that is still missing was lost, so resend it without waiting for its timer. */
+    uint8_t highestAcked = 0;
+    for(uint8_t i = 0; i < LINK_WINDOW_SIZE - 1; i++) {
+        uint8_t seq = (cumulativeAck + 1 + i) & SEQ_MASK;
+        if((selectiveAcks & BIT(i)) && seq_distance(link->sendBase, seq) < seq_distance(link->sendBase, link->sendNext)) {
+            uint8_t sample = link_acked(link, &link->sendSlots[seq & SLOT_MASK]);
+            if(sample > 0 && sample < roundTrip) {
+                roundTrip = sample;
+            }
+            highestAcked = i + 2;
+        }
+    }
+    if(roundTrip != UINT8_MAX) {
+        link_sync_clock(frame, roundTrip);
+    }
+    for(uint8_t i = 0; i < highestAcked; i++) {
+        LinkSendSlot_t* slot = &link->sendSlots[(cumulativeAck + i) & SLOT_MASK];
+        if(!slot->acked && slot->retransmitTicks < link_timeout(link)) {
+            slot->retransmitTicks = 0;
+        }
+    }
+}
+
+/** Advances the cumulative ack past every message recieved in order.
+ * @param link The link.
+*/
+static void link_advance(LinkPeer_t* link)
+{
+    while(seq_distance(link->readSeq, link->recvNext) < LINK_WINDOW_SIZE && link->recvValid[link->recvNext & SLOT_MASK]) {
+        link->recvNext = (link->recvNext + 1) & SEQ_MASK;
+    }
+}
+
+/** Handles a frame recieved from the ir channel, buffering any new message and updating acknowledgements.
+ * @param payload The frame's payload.
+ * @param length The length of the payload.
+*/
+void link_receive_frame(const uint8_t* payload, uint8_t length)
+{
+    if(length == 0 || (payload[0] & LINK_FOREIGN_FLAG)) {
+        return;
+    }
+
+    /* Only frames crossing one of our seams are for us. */
+    uint8_t peer = ((payload[0] & SEAM_MASK) >> SEAM_SHIFT) - GEOMETRY_SEAM;
+    if(peer >= LINK_NUM_PEERS) {
+        return;
+    }
+    LinkPeer_t* link = &peers[peer];
+
+    if(payload[0] & LINK_ACK_FLAG) {
+        if(length == ACK_PAYLOAD_LENGTH) {
+            uint8_t frame = ((payload[0] & SEQ_MASK) << ACK_FRAME_HIGH_SHIFT) | (payload[1] >> ACK_FRAME_LOW_SHIFT);
+            link_receive_ack(link, payload[1] & SEQ_MASK, payload[2], frame);
+        }
+        return;
+    }
+
+    uint8_t dataStart = (payload[0] & LINK_HELD_FLAG) ? MESSAGE_HEADER_LENGTH + 1 : MESSAGE_HEADER_LENGTH;
+    if(length < dataStart) {
+        return;
+    }
+
+    /* Every message is acknowledged, even duplicates, as a duplicate means our last ack was lost. */
+    link->ackPending = true;
+
+    uint8_t seq = payload[0] & SEQ_MASK;
+    uint8_t slot = seq & SLOT_MASK;
+    if(seq_distance(link->readSeq, seq) >= LINK_WINDOW_SIZE || link->recvValid[slot]) {
+        link->stats.duplicates++;
+        return;
+    }
+
+    link->recvValid[slot] = true;
+    link->recvSlots[slot].type = payload[1];
+    link->recvSlots[slot].held = dataStart > MESSAGE_HEADER_LENGTH ? payload[MESSAGE_HEADER_LENGTH] : 0;
+    link->recvSlots[slot].length = length - dataStart;
+    for(uint8_t i = 0; i < link->recvSlots[slot].length; i++) {
+        link->recvSlots[slot].data[i] = payload[i + dataStart];
+    }
+
+    link_advance(link);
+}
+
+/** Takes the next message recieved from a funkit, messages are returned in the order they were sent without duplicates.
+ * @param peer The funkit the message is from.
+ * @param message Filled in with the message.
+ * @return True if a message was returned.
+*/
+bool link_read(uint8_t peer, LinkMessage_t* message)
+{
+    LinkPeer_t* link = &peers[peer];
+    if(link->readSeq == link->recvNext) {
+        return false;
+    }
+    uint8_t slot = link->readSeq & SLOT_MASK;
+    *message = link->recvSlots[slot];
+    link->recvValid[slot] = false;
+    link->readSeq = (link->readSeq + 1) & SEQ_MASK;
+
+    /* Messages recieved out of order beyond the old window may now be in order. */
+    link_advance(link);
+    return true;
+}
+
+/** The estimated time for a message to reach a funkit, from the measured round trip from sending a message to recieving its acknowledgement.
+ * @param peer The funkit.
+ * @return The latency in frames.
+*/
+uint8_t link_latency(uint8_t peer)
+{
+    /* The ack is queued in the frame the message arrives and heard a frame later at the earliest, and is shorter than any message,
+        so the message took close to a frame less than the round trip. */
+    return ((peers[peer].smoothedRoundTrip + BIT(SRTT_SHIFT - 1)) >> SRTT_SHIFT) - 1;
+}
+
+/** The share of recent messages to a funkit that had to be retransmitted, as either the message or its acknowledgement was lost.
+ * @param peer The funkit.
+ * @return The loss estimate, from 0 to about LINK_MAX_LOSS.
+*/
+uint8_t link_loss(uint8_t peer)
+{
+    return peers[peer].loss;
+}
+
+/** The running traffic counts of the link with a funkit.
+ * @param peer The funkit.
+ * @return The counts, updated as the link sends and recieves.
+*/
+const LinkStats_t* link_stats(uint8_t peer)
+{
+    return &peers[peer].stats;
+}
+
+/** The frame counter shared with the other funkits, kept in step by the clock exchange carried on acknowledgements. It wraps every 256
+ * frames, so only the difference between two readings less than that apart has meaning, and is only in step once link_frame_synced_p.
+ * @return The shared frame.
+*/
+uint8_t link_frame(void)
+{
+    return sharedClock >> 16;
+}
+
+/** Checks if the shared frame counter has been brought in step with another funkit's.
+ * @return True once an acknowledgement has given a clock sample.
+*/
+bool link_frame_synced_p(void)
+{
+    return clockSynced;
+}
+
+/** Advances the retransmission timers and the shared frame counter, should be called once per frame. */
+void link_update(void)
+{
+    sharedClock += CLOCK_ONE_FRAME;
+    for(uint8_t peer = 0; peer < LINK_NUM_PEERS; peer++) {
+        LinkPeer_t* link = &peers[peer];
+        for(uint8_t i = 0; i < LINK_WINDOW_SIZE; i++) {
+            LinkSendSlot_t* slot = &link->sendSlots[i];
+            if(slot->acked || !slot->offered) {
+                continue;
+            }
+            if(slot->message.held < UINT8_MAX) {
+                slot->message.held++;
+            }
+            if(!slot->sent) {
+                continue;
+            }
+            /* A timer running out, other than the one for a duplicate's second copy, doubles the timeout, see LINK_MAX_TIMEOUT_DOUBLINGS. A
+                window of messages timing out together is one timeout too short, so only a message's own later timeouts double it again. */
+            if(slot->retransmitTicks > 0 && --slot->retransmitTicks == 0 && !slot->duplicatePending
+                && link->timeoutDoublings <= slot->retransmits && link->timeoutDoublings < LINK_MAX_TIMEOUT_DOUBLINGS) {
+                link->timeoutDoublings++;
+            }
+            if(slot->age < UINT8_MAX) {
+                slot->age++;
+            }
+        }
+    }
+}
+
+/** Encodes a payload in a frame and queues it to be sent over the ir channel.
+ * @param payload The payload.
+ * @param length The length of the payload.
+ * @return False if the transmit buffer doesn't have room for the whole frame, in which case nothing is queued.
+*/
+static bool link_put_frame(const uint8_t* payload, uint8_t length)
+{
+    uint8_t frame[FRAME_MAX_LENGTH];
+    uint8_t frameLength = frame_encode(frame, payload, length);
+    if(ir_queue_write_space() < frameLength) {
+        return false;
+    }
+    for(uint8_t i = 0; i < frameLength; i++) {
+        ir_queue_putc(frame[i]);
+    }
+    return true;
+}
+
+/** Queues the acknowledgement frame owed to a funkit.
+ * @param peer The funkit.
+ * @return True if the frame was queued.
+*/
+static bool link_transmit_ack(uint8_t peer)
+{
+    LinkPeer_t* link = &peers[peer];
+    uint8_t selectiveAcks = 0;
+    for(uint8_t i = 0; i < LINK_WINDOW_SIZE - 1; i++) {
+        uint8_t seq = (link->recvNext + 1 + i) & SEQ_MASK;
+        if(seq_distance(link->readSeq, seq) < LINK_WINDOW_SIZE && link->recvValid[seq & SLOT_MASK]) {
+            selectiveAcks |= BIT(i);
+        }
+    }
+    uint8_t frame = link_frame();
+    uint8_t payload[ACK_PAYLOAD_LENGTH] = {
+        peer_seam_bits(peer) | LINK_ACK_FLAG | (frame >> ACK_FRAME_HIGH_SHIFT),
+        link->recvNext | (uint8_t)(frame << ACK_FRAME_LOW_SHIFT),
+        selectiveAcks
+    };
+    if(!link_put_frame(payload, ACK_PAYLOAD_LENGTH)) {
+        return false;
+    }
+    link->ackPending = false;
+    return true;
+}
+
+/** Queues the oldest message to a funkit that is new or whose retransmission timer has run out.
+ * @param peer The funkit.
+ * @return True if a frame was queued.
+*/
+static bool link_transmit_message(uint8_t peer)
+{
+    LinkPeer_t* link = &peers[peer];
+    uint8_t payload[FRAME_MAX_PAYLOAD];
+
+    for(uint8_t seq = link->sendBase; seq != link->sendNext; seq = (seq + 1) & SEQ_MASK) {
+        LinkSendSlot_t* slot = &link->sendSlots[seq & SLOT_MASK];
+        if(slot->acked || (slot->sent && slot->retransmitTicks > 0)) {
+            continue;
+        }
+        slot->offered = true;
+        payload[0] = peer_seam_bits(peer) | seq;
+        payload[1] = slot->message.type;
+        uint8_t dataStart = MESSAGE_HEADER_LENGTH;
+        if(slot->message.held > 0) {
+            payload[0] |= LINK_HELD_FLAG;
+            payload[dataStart++] = slot->message.held;
+        }
+        for(uint8_t i = 0; i < slot->message.length; i++) {
+            payload[i + dataStart] = slot->message.data[i];
+        }
+        /* The bytes ahead of this frame in the transmit buffer, see LINK_AIR_BYTES_PER_FRAME. */
+        uint8_t queued = IR_QUEUE_TX_SIZE - 1 - ir_queue_write_space();
+        if(!link_put_frame(payload, slot->message.length + dataStart)) {
+            return false;
+        }
+        link->stats.sent++;
+        if(slot->sent) {
+            link->stats.resent++;
+        }
+        slot->retransmitTicks = link_timeout(link) + queued / LINK_AIR_BYTES_PER_FRAME;
+        if(!slot->sent && LINK_DUPLICATE_LOSS > 0 && link->loss > LINK_DUPLICATE_LOSS) {
+            slot->duplicated = true;
+            slot->duplicatePending = true;
+            slot->retransmitTicks = 1;
+        } else if(slot->duplicatePending) {
+            slot->duplicatePending = false;
+        } else if(slot->sent) {
+            if(slot->retransmits < UINT8_MAX) {
+                slot->retransmits++;
+            }
+            if(LINK_BACKOFF_FRAMES > 0) {
+                slot->retransmitTicks += link_backoff(slot->retransmits);
+            }
+        }
+        slot->timerStart = slot->retransmitTicks;
+        slot->sent = true;
+        return true;
+    }
+
+    return false;
+}
+
+/** Queues one frame to be sent over the ir channel if any is due and there is room for it, acknowledgements take priority over messages.
+ * @return True if a frame was queued.
+*/
+bool link_transmit(void)
+{
+    for(uint8_t peer = 0; peer < LINK_NUM_PEERS; peer++) {
+        if(peers[peer].ackPending) {
+            return link_transmit_ack(peer);
+        }
+    }
+    for(uint8_t peer = 0; peer < LINK_NUM_PEERS; peer++) {
+        if(link_transmit_message(peer)) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,124 @@
+/** @file link.h
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Reliable sliding window link over the ir channel, carrying typed messages in frames with cumulative and selective acknowledgements.
+    Each frame is addressed to a seam of the court (see geometry.h), and a relay board keeps a separate link with the board on each side.
+*/
+
+#ifndef LINK_H
+#define LINK_H
+
+#include "system.h"
+#include "frame.h"
+#include "geometry.h"
+
+/* The number of messages that may be sent before the first of them is acknowledged. At most half the sequence number space, so a
+    retransmitted message can always be told apart from a new one. */
+#define LINK_WINDOW_SIZE 4
+/* Bytes of message data that fit in a frame after the link header, message type and held count. */
+#define LINK_MAX_MESSAGE (FRAME_MAX_PAYLOAD - 3)
+/* Frames whose first payload byte has this bit set are not link frames and are ignored by the link, so other data can share the ir channel. */
+#define LINK_FOREIGN_FLAG 0x80
+
+/* The boards a link can be with, the board across column 0 and, for relays, the board behind the back edge. */
+#define LINK_PEER_FRONT 0
+#define LINK_PEER_BACK 1
+#define LINK_NUM_PEERS (1 + GEOMETRY_RELAY)
+
+/* The loss estimate of a link that has to retransmit every message, see link_loss. */
+#define LINK_MAX_LOSS 255
+
+/* A message carried by the link. The type is chosen by the user of the link. A recieved message's held count is the frames the sender
+    had held it for when it sent the copy that arrived, so with link_latency it gives the time since the message was sent. */
+typedef struct {
+    uint8_t type;
+    uint8_t length;
+    uint8_t held;
+    uint8_t data[LINK_MAX_MESSAGE];
+} LinkMessage_t;
+
+/* Running counts of the traffic on a link, for measuring the ir channel (see soak.h): the message frames queued, those that were copies of a
+    message already sent (retransmissions and early duplicates, see link.c), the messages acknowledged, those of them whose first copy or its
+    acknowledgement was lost, rather than only late, and the message frames recieved for messages already recieved. Each count wraps, so the
+    traffic over a time is the difference between the counts at its start and end. */
+typedef struct {
+    uint16_t sent;
+    uint16_t resent;
+    uint16_t acked;
+    uint16_t lost;
+    uint16_t duplicates;
+} LinkStats_t;
+
+/** Initializes the link, clearing all sequence numbers and buffers. Both funkits must initialize together. */
+void link_init(void);
+
+/** Queues a message to be reliably sent to another funkit.
+ * @param peer The funkit to send to, LINK_PEER_FRONT or LINK_PEER_BACK.
+ * @param type The type of the message.
+ * @param data The message data.
+ * @param length The number of bytes of data, at most LINK_MAX_MESSAGE.
+ * @return False if the window is full and the message was not queued.
+*/
+bool link_send(uint8_t peer, uint8_t type, const uint8_t* data, uint8_t length);
+
+/** Checks if every queued message to every funkit has been acknowledged.
+ * @return True if there are no messages waiting for an acknowledgement.
+*/
+bool link_idle_p(void);
+
+/** Checks if the link has nothing left to do until another frame is recieved, for sleeping through frames.
+ * @return True if every message has been acknowledged, every acknowledgement sent and every recieved message read.
+*/
+bool link_quiet_p(void);
+
+/** Handles a frame recieved from the ir channel, buffering any new message and updating acknowledgements.
+ * @param payload The frame's payload.
+ * @param length The length of the payload.
+*/
+void link_receive_frame(const uint8_t* payload, uint8_t length);
+
+/** Takes the next message recieved from a funkit, messages are returned in the order they were sent without duplicates.
+ * @param peer The funkit the message is from.
+ * @param message Filled in with the message.
+ * @return True if a message was returned.
+*/
+bool link_read(uint8_t peer, LinkMessage_t* message);
+
+/** The estimated time for a message to reach a funkit, from the measured round trip from sending a message to recieving its acknowledgement.
+ * @param peer The funkit.
+ * @return The latency in frames.
+*/
+uint8_t link_latency(uint8_t peer);
+
+/** The share of recent messages to a funkit that had to be retransmitted, as either the message or its acknowledgement was lost.
+ * @param peer The funkit.
+ * @return The loss estimate, from 0 to about LINK_MAX_LOSS.
+*/
+uint8_t link_loss(uint8_t peer);
+
+/** The running traffic counts of the link with a funkit.
+ * @param peer The funkit.
+ * @return The counts, updated as the link sends and recieves.
+*/
+const LinkStats_t* link_stats(uint8_t peer);
+
+/** The frame counter shared with the other funkits, kept in step by the clock exchange carried on acknowledgements. It wraps every 256
+ * frames, so only the difference between two readings less than that apart has meaning, and is only in step once link_frame_synced_p. The
+ * game paces its physics by it and times ball handoffs with it.
+ * @return The shared frame.
+*/
+uint8_t link_frame(void);
+
+/** Checks if the shared frame counter has been brought in step with another funkit's.
+ * @return True once an acknowledgement has given a clock sample.
+*/
+bool link_frame_synced_p(void);
+
+/** Advances the retransmission timers and the shared frame counter, should be called once per frame. */
+void link_update(void);
+
+/** Queues one frame to be sent over the ir channel if any is due and there is room for it, an acknowledgement takes priority over messages.
+ * @return True if a frame was queued.
+*/
+bool link_transmit(void);
+
+#endif //LINK_H
\ No newline at end of file
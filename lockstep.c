@@ -0,0 +1,328 @@
+/** @file lockstep.c
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Lockstep simulation of the whole court, both funkits run the same physics for both halves and exchange only their inputs.
+*/
+
+#include "lockstep.h"
+#include "frame.h"
+#include "ir_queue.h"
+
+/* Frame numbers wrap at 256. Every buffered input lies within LOCKSTEP_BUFFER_SIZE frames of the first unconfirmed frame, which must be a
+    power of two so frame numbers can be wrapped into it with a mask. */
+#define LOCKSTEP_BUFFER_SIZE 32
+#define BUFFER_MASK (LOCKSTEP_BUFFER_SIZE - 1)
+#define ROLLBACK_MASK (LOCKSTEP_ROLLBACK_FRAMES - 1)
+#define LOCKSTEP_FRAME_HEADER_LENGTH 3
+/* The most inputs sent in a frame, twice the inputs needed per frame so a funkit that has fallen behind can catch up. */
+#define LOCKSTEP_MAX_SEND (2 * LOCKSTEP_SEND_FRAMES)
+/* The number of frames sent without the acknowledgement advancing before the unacknowledged inputs are all resent. */
+#define LOCKSTEP_RESEND_FRAMES 3
+
+/* Bits of a packed input, only the inputs used by the physics are sent. */
+#define INPUT_NORTH BIT(0)
+#define INPUT_SOUTH BIT(1)
+#define INPUT_WEST BIT(2)
+#define INPUT_BITS 4
+#define INPUT_MASK (BIT(INPUT_BITS) - 1)
+/* The other funkit's input is predicted to be unchanged, and as inputs are push events that means no input. */
+#define PREDICTED_INPUT 0
+
+/* Everything the simulation of a frame changes. */
+typedef struct {
+    PhysicsState_t players[LOCKSTEP_NUM_PLAYERS];
+    uint8_t ballPlayer;
+} LockstepSnapshot_t;
+
+#ifdef __AVR__
+_Static_assert(sizeof(LockstepSnapshot_t) == LOCKSTEP_SNAPSHOT_BYTES, "LOCKSTEP_SNAPSHOT_BYTES is out of date");
+#endif
+
+/* The state at the start of simFrame, and of each frame from confirmedNext, the first frame simulated with a predicted input, up to simFrame.
+    The other funkit's input each of those frames was simulated with is kept in predictions, to be checked when the real input arrives. */
+static LockstepSnapshot_t current;
+static LockstepSnapshot_t snapshots[LOCKSTEP_ROLLBACK_FRAMES];
+static uint8_t predictions[LOCKSTEP_ROLLBACK_FRAMES];
+static uint8_t confirmedNext;
+static uint8_t localPlayer;
+static uint8_t header;
+static uint16_t ticksPerFrame;
+
+/* simFrame is the next frame to simulate. Local inputs are known up to (not including) localNext and the other funkit's up to remoteNext,
+    peerNext is the first local input the other funkit has not acknowledged. */
+static uint8_t localInputs[LOCKSTEP_BUFFER_SIZE];
+static uint8_t remoteInputs[LOCKSTEP_BUFFER_SIZE];
+static uint8_t simFrame;
+static uint8_t localNext;
+static uint8_t remoteNext;
+static uint8_t peerNext;
+
+/* Acknowledgements take a round trip to arrive, so rather than resending every input from peerNext each frame only carries on from sentNext,
+    the first input not yet sent, repeating the inputs of the last frame so a single lost frame loses nothing. If the acknowledgement stops
+    advancing more was lost, so sending goes back to peerNext. */
+static uint8_t sentNext;
+static uint8_t lastPeerNext;
+static uint8_t staleFrames;
+
+/* Push events that couldn't be scheduled yet as the simulation is waiting, they are added to the next scheduled input so none are lost. */
+static uint8_t pendingInput;
+static uint8_t sendTimer;
+
+/** The distance from one frame number to another.
+ * @param from The earlier frame number.
+ * @param to The later frame number.
+ * @return The number of frames between the two.
+*/
+static uint8_t frame_distance(uint8_t from, uint8_t to)
+{
+    return to - from;
+}
+
+/** Packs the inputs used by the physics into a nibble.
+ * @param input The input.
+ * @return The packed input.
+*/
+static uint8_t input_pack(Input_t input)
+{
+    return (input.north ? INPUT_NORTH : 0) | (input.south ? INPUT_SOUTH : 0) | (input.west ? INPUT_WEST : 0);
+}
+
+/** Unpacks an input packed by input_pack.
+ * @param packed The packed input.
+ * @return The input.
+*/
+static Input_t input_unpack(uint8_t packed)
+{
+    Input_t input = {
+        .north = (packed & INPUT_NORTH) != 0,
+        .south = (packed & INPUT_SOUTH) != 0,
+        .west = (packed & INPUT_WEST) != 0
+    };
+    return input;
+}
+
+/** Starts a round of lockstep simulation, resetting the frame count and both physics states.
+ * @param player This funkit's player number, 0 if it starts with the ball.
+ * @param round The round number, which must match on both funkits.
+ * @param frameTicks The timer ticks in a frame, which must match on both funkits.
+*/
+void lockstep_init(uint8_t player, uint8_t round, uint16_t frameTicks)
+{
+    current.players[0] = physics_init(true);
+    current.players[1] = physics_init(false);
+    current.ballPlayer = 0;
+    localPlayer = player;
+    header = LOCKSTEP_HEADER | (round & LOCKSTEP_ROUND_MASK);
+    ticksPerFrame = frameTicks;
+
+    /* The frames before the first scheduled input have no input from either player. */
+    for(uint8_t i = 0; i < LOCKSTEP_BUFFER_SIZE; i++) {
+        localInputs[i] = 0;
+        remoteInputs[i] = 0;
+    }
+    simFrame = 0;
+    confirmedNext = 0;
+    localNext = LOCKSTEP_INPUT_DELAY;
+    remoteNext = LOCKSTEP_INPUT_DELAY;
+    peerNext = LOCKSTEP_INPUT_DELAY;
+    sentNext = LOCKSTEP_INPUT_DELAY;
+    lastPeerNext = LOCKSTEP_INPUT_DELAY;
+    staleFrames = 0;
+    pendingInput = 0;
+    sendTimer = 0;
+}
+
+/** Handles a frame recieved from the ir channel, storing any new inputs from the other funkit.
+ * @param payload The frame's payload.
+ * @param length The length of the payload.
+*/
+void lockstep_receive_frame(const uint8_t* payload, uint8_t length)
+{
+    /* Nothing is taken before the first round starts, as a header of 0 would match other frames. */
+    if(header == 0 || length < LOCKSTEP_FRAME_HEADER_LENGTH || (payload[0] & ~LOCKSTEP_ODD_FLAG) != header) {
+        return;
+    }
+    uint8_t first = payload[1];
+    uint8_t ack = payload[2];
+    uint8_t count = 2 * (length - LOCKSTEP_FRAME_HEADER_LENGTH);
+    if(count > 0 && (payload[0] & LOCKSTEP_ODD_FLAG)) {
+        count--;
+    }
+
+    /* Only an acknowledgement of frames we have sent can be newer than the last one. */
+    if(frame_distance(peerNext, ack) <= frame_distance(peerNext, localNext)) {
+        peerNext = ack;
+        if(frame_distance(peerNext, sentNext) > frame_distance(peerNext, localNext)) {
+            sentNext = peerNext;
+        }
+    }
+
+    /* Take the inputs that continue on from the last recieved one, anything after a gap is resent once the gap is acknowledged. */
+    for(uint8_t i = 0; i < count; i++) {
+        uint8_t frame = first + i;
+        if(frame != remoteNext || frame_distance(confirmedNext, remoteNext) >= LOCKSTEP_BUFFER_SIZE) {
+            continue;
+        }
+        uint8_t packed = payload[LOCKSTEP_FRAME_HEADER_LENGTH + i / 2] >> ((i & 1) * INPUT_BITS);
+        remoteInputs[frame & BUFFER_MASK] = packed & INPUT_MASK;
+        remoteNext++;
+    }
+}
+
+/** Simulates simFrame from the current state, saving the state first so the frame can be rolled back. The other funkit's input is used if it
+    has arrived, otherwise it is predicted. */
+static void lockstep_advance(void)
+{
+    uint8_t slot = simFrame & ROLLBACK_MASK;
+    snapshots[slot] = current;
+    bool remoteKnown = frame_distance(confirmedNext, simFrame) < frame_distance(confirmedNext, remoteNext);
+    predictions[slot] = remoteKnown ? remoteInputs[simFrame & BUFFER_MASK] : PREDICTED_INPUT;
+
+    uint8_t inputs[LOCKSTEP_NUM_PLAYERS];
+    inputs[localPlayer] = localInputs[simFrame & BUFFER_MASK];
+    inputs[!localPlayer] = predictions[slot];
+    simFrame++;
+
+    /* Both players are updated from the state at the start of the frame, then a ball that left one half is moved on to the other, where it
+        carries on the next frame. Whichever way it crosses it spends the rest of the frame in the air, as a handoff would. */
+    for(uint8_t player = 0; player < LOCKSTEP_NUM_PLAYERS; player++) {
+        current.players[player] = physics_update(current.players[player], input_unpack(inputs[player]), ticksPerFrame);
+    }
+    PhysicsState_t* state = &current.players[current.ballPlayer];
+    if(!state->ballActive && !state->gameOver) {
+        /* physics_update has already mirrored the ball in to the other player's view. */
+        current.ballPlayer = !current.ballPlayer;
+        PhysicsState_t* other = &current.players[current.ballPlayer];
+        other->ballActive = true;
+        other->ballPosR = state->ballPosR;
+        other->ballPosC = state->ballPosC;
+        other->ballVelR = state->ballVelR;
+        other->ballVelC = state->ballVelC;
+    }
+}
+
+/** Checks the predictions of every simulated frame the other funkit's real input has since arrived for. The state is rolled back to the first
+    frame that was mispredicted and simulated again up to where it was.
+ * @return True if the state was rolled back.
+*/
+static bool lockstep_confirm(void)
+{
+    bool rolledBack = false;
+    while(confirmedNext != simFrame && confirmedNext != remoteNext) {
+        uint8_t slot = confirmedNext & ROLLBACK_MASK;
+        if(predictions[slot] != remoteInputs[confirmedNext & BUFFER_MASK]) {
+            uint8_t end = simFrame;
+            current = snapshots[slot];
+            simFrame = confirmedNext;
+            while(simFrame != end) {
+                lockstep_advance();
+            }
+            rolledBack = true;
+        }
+        confirmedNext++;
+    }
+    return rolledBack;
+}
+
+/** Schedules this frame's input, then simulates the next frame, predicting the other funkit's input if it hasn't arrived. Should be called once per frame.
+ * @param input The input for this frame.
+ * @return True if the state changed, false if the simulation is waiting as it has predicted as far ahead as it can.
+*/
+bool lockstep_update(Input_t input)
+{
+    /* Inputs are scheduled LOCKSTEP_INPUT_DELAY frames ahead of the simulation, and never past what the buffer can hold until acknowledged. */
+    pendingInput |= input_pack(input);
+    if(frame_distance(simFrame, localNext) <= LOCKSTEP_INPUT_DELAY && frame_distance(peerNext, localNext) < LOCKSTEP_BUFFER_SIZE) {
+        localInputs[localNext & BUFFER_MASK] = pendingInput;
+        localNext++;
+        pendingInput = 0;
+    }
+
+    bool changed = lockstep_confirm();
+    if(simFrame != localNext && frame_distance(confirmedNext, simFrame) < LOCKSTEP_ROLLBACK_FRAMES) {
+        lockstep_advance();
+        lockstep_confirm();
+        changed = true;
+    }
+    return changed;
+}
+
+/** The physics state of a player, as seen from that player's funkit. This may be predicted, see lockstep_confirmed_state.
+ * @param player The player.
+ * @return The physics state, ballActive is set if the ball is on that player's half and gameOver if that player has lost the round.
+*/
+PhysicsState_t lockstep_player_state(uint8_t player)
+{
+    return current.players[player];
+}
+
+/** The physics state of a player at the first frame whose input from the other funkit hasn't arrived, which is never rolled back.
+ * @param player The player.
+ * @return The physics state, as for lockstep_player_state.
+*/
+PhysicsState_t lockstep_confirmed_state(uint8_t player)
+{
+    if(confirmedNext == simFrame) {
+        return current.players[player];
+    }
+    return snapshots[confirmedNext & ROLLBACK_MASK].players[player];
+}
+
+/** The first frame whose input from the other funkit hasn't arrived, every frame before it is confirmed.
+ * @return The frame number, counted from the start of the round and wrapping at 256.
+*/
+uint8_t lockstep_confirmed_frame(void)
+{
+    return confirmedNext;
+}
+
+/** Queues a frame of inputs to be sent over the ir channel if one is due and there is room for it, should be called once per frame. */
+void lockstep_transmit(void)
+{
+    /* Nothing is sent before the first round starts, the header is only set by lockstep_init. */
+    if(header == 0) {
+        return;
+    }
+    if(sendTimer > 0) {
+        sendTimer--;
+        return;
+    }
+
+    if(peerNext == lastPeerNext && peerNext != localNext) {
+        if(++staleFrames >= LOCKSTEP_RESEND_FRAMES) {
+            sentNext = peerNext;
+            staleFrames = 0;
+        }
+    } else {
+        lastPeerNext = peerNext;
+        staleFrames = 0;
+    }
+
+    uint8_t first = peerNext;
+    if(frame_distance(peerNext, sentNext) > LOCKSTEP_SEND_FRAMES) {
+        first = sentNext - LOCKSTEP_SEND_FRAMES;
+    }
+    uint8_t count = frame_distance(first, localNext);
+    if(count > LOCKSTEP_MAX_SEND) {
+        count = LOCKSTEP_MAX_SEND;
+    }
+    uint8_t payload[FRAME_MAX_PAYLOAD] = {header | ((count & 1) ? LOCKSTEP_ODD_FLAG : 0), first, remoteNext};
+    for(uint8_t i = 0; i < count; i++) {
+        uint8_t packed = localInputs[(first + i) & BUFFER_MASK];
+        if(i & 1) {
+            payload[LOCKSTEP_FRAME_HEADER_LENGTH + i / 2] |= packed << INPUT_BITS;
+        } else {
+            payload[LOCKSTEP_FRAME_HEADER_LENGTH + i / 2] = packed;
+        }
+    }
+
+    uint8_t frame[FRAME_MAX_LENGTH];
+    uint8_t frameLength = frame_encode(frame, payload, LOCKSTEP_FRAME_HEADER_LENGTH + (count + 1) / 2);
+    if(ir_queue_write_space() < frameLength) {
+        return;
+    }
+    for(uint8_t i = 0; i < frameLength; i++) {
+        ir_queue_putc(frame[i]);
+    }
+    sentNext = first + count;
+    sendTimer = LOCKSTEP_SEND_FRAMES - 1;
+}
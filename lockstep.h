@@ -0,0 +1,83 @@
+/** @file lockstep.h
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Lockstep simulation of the whole court, both funkits run the same physics for both halves and exchange only their inputs.
+*/
+
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+#include "system.h"
+#include "input.h"
+#include "physics.h"
+#include "link.h"
+
+/* Both funkits hold a physics state for each player, player 0 being the funkit that started the round with the ball. Every lockstep frame
+    both states are updated with that frame's input from each player, and the ball is moved from one state to the other at the end of the
+    frame it crosses the boundary, so there is no handoff. As physics_update is a pure function and the time step is fixed, both funkits compute exactly the
+    same states as long as they use the same inputs.
+    Rather than waiting for the other funkit's input, each frame is simulated as soon as it is due with that input predicted, so local input
+    takes effect the next frame whatever the delay of the ir channel. The state at the start of each frame simulated with a prediction is
+    saved, and when the real input arrives and differs the state is rolled back to that frame and simulated again. A funkit waits only
+    when it is LOCKSTEP_ROLLBACK_FRAMES ahead of the other funkit's input, each saved state takes LOCKSTEP_SNAPSHOT_BYTES of SRAM. Local
+    input can also be scheduled LOCKSTEP_INPUT_DELAY frames ahead, which makes rollbacks less likely at the cost of latency. */
+#ifndef LOCKSTEP_INPUT_DELAY
+#define LOCKSTEP_INPUT_DELAY 0
+#endif
+/* Must be a power of two. */
+#ifndef LOCKSTEP_ROLLBACK_FRAMES
+#define LOCKSTEP_ROLLBACK_FRAMES 8
+#endif
+#define LOCKSTEP_NUM_PLAYERS 2
+/* A saved state on the avr, where structs aren't padded, both physics states and the player with the ball. Checked in lockstep.c. */
+#define LOCKSTEP_SNAPSHOT_BYTES 31
+
+/* Input frames are standard frames (see frame.h) sent every LOCKSTEP_SEND_FRAMES frames, ignored by the link (see link.h). The header holds
+    the round in its low bits so frames left over from the last round are ignored, and LOCKSTEP_ODD_FLAG if the last input byte holds only one
+    input. It is followed by the first frame number in the frame, the next frame number the sender needs from the reciever (an acknowledgement
+    of every frame before it), then the inputs packed two per byte. Inputs are resent until acknowledged. Each frame is about 10 bytes, so
+    they take two thirds of the ir channel's airtime. */
+#define LOCKSTEP_HEADER (LINK_FOREIGN_FLAG | 0x10)
+#define LOCKSTEP_ODD_FLAG 0x08
+#define LOCKSTEP_ROUND_MASK 0x07
+#define LOCKSTEP_SEND_FRAMES 3
+
+/** Starts a round of lockstep simulation, resetting the frame count and both physics states.
+ * @param player This funkit's player number, 0 if it starts with the ball.
+ * @param round The round number, which must match on both funkits.
+ * @param frameTicks The timer ticks in a frame, which must match on both funkits.
+*/
+void lockstep_init(uint8_t player, uint8_t round, uint16_t frameTicks);
+
+/** Handles a frame recieved from the ir channel, storing any new inputs from the other funkit.
+ * @param payload The frame's payload.
+ * @param length The length of the payload.
+*/
+void lockstep_receive_frame(const uint8_t* payload, uint8_t length);
+
+/** Schedules this frame's input, then simulates the next frame, predicting the other funkit's input if it hasn't arrived. Should be called once per frame.
+ * @param input The input for this frame.
+ * @return True if the state changed, false if the simulation is waiting as it has predicted as far ahead as it can.
+*/
+bool lockstep_update(Input_t input);
+
+/** The physics state of a player, as seen from that player's funkit. This may be predicted, see lockstep_confirmed_state.
+ * @param player The player.
+ * @return The physics state, ballActive is set if the ball is on that player's half and gameOver if that player has lost the round.
+*/
+PhysicsState_t lockstep_player_state(uint8_t player);
+
+/** The physics state of a player at the first frame whose input from the other funkit hasn't arrived, which is never rolled back.
+ * @param player The player.
+ * @return The physics state, as for lockstep_player_state.
+*/
+PhysicsState_t lockstep_confirmed_state(uint8_t player);
+
+/** The first frame whose input from the other funkit hasn't arrived, every frame before it is confirmed.
+ * @return The frame number, counted from the start of the round and wrapping at 256.
+*/
+uint8_t lockstep_confirmed_frame(void);
+
+/** Queues a frame of inputs to be sent over the ir channel if one is due and there is room for it, should be called once per frame. */
+void lockstep_transmit(void);
+
+#endif //LOCKSTEP_H
\ No newline at end of file
@@ -4,28 +4,53 @@
  */
 
 #include "physics.h"
-#include "navswitch.h"
+#include "geometry.h"
+#include "timer.h"
 #include <stdlib.h>
 
-/* Constants. */
-#define BALL_INIT_R 300
+/* Converts a posistion in leds, plus a number of half leds, to subpixels. */
+#define PIXELS(whole, halves) ((whole) * PHYSICS_SUBPIXEL + (halves) * (PHYSICS_SUBPIXEL / 2))
+/* Converts a velocity in hundredths of a led per tick to subpixels per tick, rounded to the nearest. */
+#define VELOCITY(hundredths) (((hundredths) * PHYSICS_SUBPIXEL + 50) / 100)
+
+/* Constants, generated from the court in geometry.h. */
+#define BALL_INIT_R PIXELS(GEOMETRY_BALL_INIT_R, 0)
 #define BALL_INIT_C 0
-#define BALL_INIT_VEL 5
-#define BALL_MAX_VEL_C 7
+#define BALL_INIT_VEL VELOCITY(GEOMETRY_BALL_SPEED)
+#define BALL_MAX_VEL_C VELOCITY(GEOMETRY_BALL_MAX_SPEED)
 
-#define PADDLE_INIT_R 2
-#define PADDLE_COL 4
-#define PADDLE_FORWARD_COL 3
+#define PADDLE_INIT_R GEOMETRY_PADDLE_INIT_R
+#define PADDLE_COL GEOMETRY_PADDLE_COL
+#define PADDLE_FORWARD_COL GEOMETRY_PADDLE_FORWARD_COL
 #define PADDLE_FORWARD_TICKS 8
-#define PADDLE_MAX_R 5
+#define PADDLE_MAX_R GEOMETRY_PADDLE_MAX_R
 
-#define LEFT_EDGE 50
-#define RIGHT_EDGE 650
+/* Edges are in the middle of an led, the ball reflects off the side walls in the middle of the outer rows, off the paddle in the middle of the
+    column in front of it, and is lost in the middle of the paddle's column. */
+#define LEFT_EDGE PIXELS(0, 1)
+#define RIGHT_EDGE PIXELS(GEOMETRY_ROWS - 1, 1)
 #define BOTTOM_EDGE 0
-#define TOP_EDGE 450
-#define PADDLE_EDGE 350
-#define PADDLE_FORWARD_EDGE 250
-#define REVERSE_R 699
+#define TOP_EDGE PIXELS(PADDLE_COL, 1)
+#define PADDLE_EDGE PIXELS(PADDLE_COL - 1, 1)
+#define PADDLE_FORWARD_EDGE PIXELS(PADDLE_FORWARD_COL - 1, 1)
+/* The boundary past the last column, relay boards hand the ball on to the next board across it. */
+#define BACK_EDGE PIXELS(GEOMETRY_COLS, 0)
+/* Mirrors a row posistion for the other funkit, which faces this one. */
+#define REVERSE_R (LEFT_EDGE + RIGHT_EDGE - 1)
+
+/* A ball can move a tick past any edge before it is reflected, so each must leave that much headroom in a PhysicsPos_t, and velocities are stored in an int8_t. */
+_Static_assert(BALL_INIT_VEL >= 1, "GEOMETRY_BALL_SPEED is below one subpixel per tick");
+_Static_assert(BALL_MAX_VEL_C <= INT8_MAX, "GEOMETRY_BALL_MAX_SPEED does not fit an int8_t velocity");
+_Static_assert(REVERSE_R + BALL_MAX_VEL_C <= INT16_MAX, "the court rows do not fit a PhysicsPos_t");
+_Static_assert(BACK_EDGE + BALL_MAX_VEL_C <= INT16_MAX, "the court columns do not fit a PhysicsPos_t");
+
+/* Timer ticks per physics tick. */
+#define PHYSICS_PERIOD (TIMER_RATE / PHYSICS_RATE)
+
+/* The ball's row posistion repeats every FOLD_PERIOD subpixels when its path is unfolded off the side walls, which reflect it about
+    LEFT_EDGE and half a subpixel before RIGHT_EDGE, see physics_step. */
+#define FOLD_SPAN (RIGHT_EDGE - LEFT_EDGE)
+#define FOLD_PERIOD (2 * FOLD_SPAN - 1)
 
 
 /** Initalizes the physics state.
@@ -36,54 +61,64 @@ PhysicsState_t physics_init(bool ballActive)
 {
     PhysicsState_t physicsState = {
         .ballActive = ballActive,
+        .ballExitBack = false,
         .gameOver = false,
         .ballPosR = BALL_INIT_R,
         .ballPosC = BALL_INIT_C,
         .ballVelR = BALL_INIT_VEL,
         .ballVelC = BALL_INIT_VEL,
         .paddleR = PADDLE_INIT_R,
-        .paddleC = PADDLE_COL
+        .paddleC = PADDLE_COL,
+        .paddleForwardTicks = 0,
+        .paddleBoost = false,
+        .tickAccumulator = 0
     };
     return physicsState;
 }
 
-/** Updates the state of the ball and paddle, handling collisions.
- * @param currentState The current physics state.
- * @return the new physics state.
+/** Checks if the paddle covers the row a ball posistion is in.
+ * @param ballPosR The row posistion of the ball in subpixels.
+ * @param paddleR The row of the top of the paddle.
+ * @return True if the ball is in one of the paddle's rows.
 */
-PhysicsState_t physics_update(PhysicsState_t currentState)
+static bool paddle_covers(PhysicsPos_t ballPosR, int8_t paddleR)
 {
-    navswitch_update();
-
-    if(navswitch_push_event_p(NAVSWITCH_SOUTH)) {
-        currentState.paddleR++;
-    } else if(navswitch_push_event_p(NAVSWITCH_NORTH)) {
-        currentState.paddleR--;
-    }
-
-    /* Check for a forward input and if so paddle is forward for PADDLE_FORWARD_TICKS frames, with a seperate variable for the physics so only hits the ball once. */
-    static uint8_t pushtick = 0;
-    static int8_t paddlePhysicsCol = PADDLE_COL;
-    if(navswitch_push_event_p(NAVSWITCH_WEST) || pushtick>0) {
-        currentState.paddleC = PADDLE_FORWARD_COL;
-        if(pushtick == 0) {
-            pushtick = PADDLE_FORWARD_TICKS;
-            paddlePhysicsCol = PADDLE_FORWARD_COL;
-        }
-        pushtick--;
-    } else {
-        currentState.paddleC = PADDLE_COL;
-        paddlePhysicsCol = PADDLE_COL;
-    }
-
-    if(currentState.paddleR > PADDLE_MAX_R) currentState.paddleR = PADDLE_MAX_R;
-    if(currentState.paddleR < 0) currentState.paddleR = 0;
+    /* Rows above the paddle wrap around to a large offset. */
+    uint8_t offset = PHYSICS_PIXEL(ballPosR) - paddleR;
+    return offset < GEOMETRY_PADDLE_LENGTH;
+}
 
-    /* If ball is not active we return after the paddle movement is complete. */
-    if(!currentState.ballActive) {
-        return currentState;
+/** Finds the row posistion where the ball's path during a tick crosses a column posistion, reflected off the side walls the same way as the ball.
+ * The crossing happens (col - startC) / velC of the way through the tick, so the row moves by that fraction of velR. This is the only division,
+ * and is only needed on ticks where the ball crosses the column, which velC must be non zero for.
+ * @param startR The row posistion at the start of the tick.
+ * @param startC The column posistion at the start of the tick.
+ * @param velR The row velocity during the tick.
+ * @param velC The column velocity during the tick.
+ * @param col The column posistion crossed.
+ * @return The row posistion at the crossing.
+*/
+static PhysicsPos_t row_at_crossing(PhysicsPos_t startR, PhysicsPos_t startC, int8_t velR, int8_t velC, PhysicsPos_t col)
+{
+    /* |velR * (col - startC)| <= 127 * 127, so the product fits in 16 bits. */
+    PhysicsPos_t rowAt = startR + (int16_t)(velR * (col - startC)) / velC;
+    if(rowAt < LEFT_EDGE) {
+        rowAt = LEFT_EDGE + (LEFT_EDGE - rowAt);
+    } else if(rowAt >= RIGHT_EDGE) {
+        rowAt = RIGHT_EDGE - 1 - (rowAt - RIGHT_EDGE);
     }
+    return rowAt;
+}
 
+/** Advances the ball by one physics tick, handling collisions.
+ * @param currentState The current physics state, with the ball active.
+ * @return the new physics state.
+*/
+static PhysicsState_t physics_step(PhysicsState_t currentState)
+{
+    PhysicsPos_t startR = currentState.ballPosR;
+    PhysicsPos_t startC = currentState.ballPosC;
+    int8_t startVelR = currentState.ballVelR;
     currentState.ballPosR += currentState.ballVelR;
     currentState.ballPosC += currentState.ballVelC;
     
@@ -96,38 +131,186 @@ PhysicsState_t physics_update(PhysicsState_t currentState)
         currentState.ballPosR = RIGHT_EDGE - 1 - (currentState.ballPosR - RIGHT_EDGE);
         currentState.ballVelR = -currentState.ballVelR; 
     }
-    /* Transistion edge (to other funkit). */
+    /* Transistion edge (to other funkit), the ball is left in the other funkit's view. */
     if(currentState.ballPosC < BOTTOM_EDGE) {
         currentState.ballActive = false;
-        currentState.ballPosC = abs(currentState.ballPosC);
-        currentState.ballVelC = abs(currentState.ballVelC);
-        currentState.ballPosR = REVERSE_R - currentState.ballPosR;
-        currentState.ballVelR = -currentState.ballVelR;
+        currentState.ballExitBack = false;
+        if(GEOMETRY_SEAM == 0) {
+            /* The other funkit faces this one. */
+            currentState.ballPosC = abs(currentState.ballPosC);
+            currentState.ballVelC = abs(currentState.ballVelC);
+            currentState.ballPosR = REVERSE_R - currentState.ballPosR;
+            currentState.ballVelR = -currentState.ballVelR;
+        } else {
+            /* The board in front is a relay facing the same way, the ball carries on over its back edge. */
+            currentState.ballPosC += BACK_EDGE;
+        }
         return currentState;
     }
-    /* Losing edge. */
-    if(currentState.ballPosC >= TOP_EDGE) {
-        currentState.gameOver = true;
+    /* Relay boards have no paddle, the board behind faces the same way and the ball carries on from its column 0. */
+    if(GEOMETRY_RELAY) {
+        if(currentState.ballPosC >= BACK_EDGE) {
+            currentState.ballActive = false;
+            currentState.ballExitBack = true;
+            currentState.ballPosC -= BACK_EDGE;
+        }
         return currentState;
     }
-
-    /* Paddle collision. */
+    /* Paddle collision. If the ball crossed the paddle edge during this tick, it is tested against the paddle at the row where it crossed,
+        so a fast ball can't skip past the paddle or be judged on the row it ends up in. A ball already past the edge is tested where it is,
+        so the paddle can still be moved on to it. This is done before the losing edge so a ball can't pass through the paddle and out in one tick. */
     if(currentState.ballPosC >= PADDLE_EDGE) {
-        uint8_t tmpr = currentState.ballPosR / PHYSICS_SUBPIXEL;
-        if(tmpr == currentState.paddleR || tmpr == currentState.paddleR + 1) {
+        bool hit;
+        if(startC < PADDLE_EDGE) {
+            hit = paddle_covers(row_at_crossing(startR, startC, startVelR, currentState.ballVelC, PADDLE_EDGE), currentState.paddleR);
+        } else {
+            hit = paddle_covers(currentState.ballPosR, currentState.paddleR);
+        }
+        if(hit) {
             currentState.ballPosC = PADDLE_EDGE - 1 - (currentState.ballPosC - PADDLE_EDGE);
             currentState.ballVelC = -abs(currentState.ballVelC);
         }
     }
+    /* Losing edge. */
+    if(currentState.ballPosC >= TOP_EDGE) {
+        currentState.gameOver = true;
+        return currentState;
+    }
     /* If paddle is forward, increase column speed of ball. */
-    if(currentState.ballPosC >= PADDLE_FORWARD_EDGE && paddlePhysicsCol == PADDLE_FORWARD_COL) {
-        uint8_t tmpr = currentState.ballPosR / PHYSICS_SUBPIXEL;
-        if(tmpr == currentState.paddleR || tmpr == currentState.paddleR + 1) {
+    if(currentState.ballPosC >= PADDLE_FORWARD_EDGE && currentState.paddleBoost) {
+        if(paddle_covers(currentState.ballPosR, currentState.paddleR)) {
             currentState.ballVelC = -abs(currentState.ballVelC) - 1;
             if(currentState.ballVelC < -BALL_MAX_VEL_C) currentState.ballVelC = -BALL_MAX_VEL_C;
-            paddlePhysicsCol = PADDLE_COL; 
+            currentState.paddleBoost = false;
+        }
+    }
+
+    return currentState;
+}
+
+/** Puts a ball handed over by another funkit on this board, given in this board's view.
+ * @param currentState The current physics state.
+ * @param ballPosR The row posistion of the ball in subpixels.
+ * @param ballVelR The velocity of the ball in the row direction.
+ * @param ballVelC The velocity of the ball in the column direction.
+ * @param fromBack True if the ball crossed the back edge of this relay board, otherwise it crossed column 0.
+ * @param lateTicks The timer ticks since the ball left the other funkit, the ball is moved on by the physics ticks due in that time.
+ * @return The physics state with the ball active.
+*/
+PhysicsState_t physics_receive_ball(PhysicsState_t currentState, PhysicsPos_t ballPosR, int8_t ballVelR, int8_t ballVelC, bool fromBack, uint16_t lateTicks)
+{
+    currentState.ballActive = true;
+    currentState.ballPosR = ballPosR;
+    currentState.ballPosC = fromBack ? BACK_EDGE - 1 : BOTTOM_EDGE;
+    currentState.ballVelR = ballVelR;
+    currentState.ballVelC = ballVelC;
+    /* The next update catches up on the ticks, at most PHYSICS_MAX_SUBSTEPS of them as for any long frame. */
+    currentState.tickAccumulator = lateTicks;
+    return currentState;
+}
+
+/** Updates the state of the paddle from the input, then runs the physics ticks due in the elapsed time, handling collisions.
+ * This is a pure function of its arguments, so the same inputs always give the same state.
+ * @param currentState The current physics state.
+ * @param input The input for this frame.
+ * @param elapsed The time since the last update in timer ticks.
+ * @return the new physics state.
+*/
+PhysicsState_t physics_update(PhysicsState_t currentState, Input_t input, uint16_t elapsed)
+{
+    if(input.south) {
+        currentState.paddleR++;
+    } else if(input.north) {
+        currentState.paddleR--;
+    }
+
+    /* Check for a forward input and if so paddle is forward for PADDLE_FORWARD_TICKS frames, with a seperate flag for the physics so only hits the ball once. */
+    if(input.west || currentState.paddleForwardTicks > 0) {
+        currentState.paddleC = PADDLE_FORWARD_COL;
+        if(currentState.paddleForwardTicks == 0) {
+            currentState.paddleForwardTicks = PADDLE_FORWARD_TICKS;
+            currentState.paddleBoost = true;
+        }
+        currentState.paddleForwardTicks--;
+    } else {
+        currentState.paddleC = PADDLE_COL;
+        currentState.paddleBoost = false;
+    }
+
+    if(currentState.paddleR > PADDLE_MAX_R) currentState.paddleR = PADDLE_MAX_R;
+    if(currentState.paddleR < 0) currentState.paddleR = 0;
+
+    /* If ball is not active we return after the paddle movement is complete. */
+    if(!currentState.ballActive) {
+        currentState.tickAccumulator = 0;
+        return currentState;
+    }
+
+    /* Run every physics tick that has come due, stopping early if the ball leaves the board. */
+    currentState.tickAccumulator += elapsed;
+    uint8_t substeps = 0;
+    while(currentState.tickAccumulator >= PHYSICS_PERIOD && substeps < PHYSICS_MAX_SUBSTEPS) {
+        currentState.tickAccumulator -= PHYSICS_PERIOD;
+        substeps++;
+        currentState = physics_step(currentState);
+        if(!currentState.ballActive || currentState.gameOver) {
+            currentState.tickAccumulator = 0;
+            break;
         }
     }
+    /* Drop any time we couldn't catch up on rather than running slow forever. */
+    if(currentState.tickAccumulator >= PHYSICS_PERIOD) {
+        currentState.tickAccumulator = 0;
+    }
 
     return currentState;
 }
+
+/** Folds a row posistion on the ball's path unfolded off the side walls back on to the court.
+ * @param unfolded The row posistion the ball would reach without the side walls.
+ * @return The row posistion the ball reaches.
+*/
+static PhysicsPos_t fold_row(int32_t unfolded)
+{
+    int32_t offset = (unfolded - LEFT_EDGE) % FOLD_PERIOD;
+    if(offset < 0) {
+        offset += FOLD_PERIOD;
+    }
+    if(offset >= FOLD_SPAN) {
+        offset = FOLD_PERIOD - offset;
+    }
+    return LEFT_EDGE + offset;
+}
+
+/** Chooses the input an ai player gives, moving the paddle to where the ball will cross the paddle edge, or back to the middle while the
+ * ball is going away. The crossing is found in constant time, from the ball's path unfolded into a straight line and folded back between the
+ * side walls, rather than by stepping the ball. Relay boards have no paddle to move.
+ * @param state The physics state.
+ * @return The input, with only north or south set.
+*/
+Input_t physics_ai_input(const PhysicsState_t* state)
+{
+    int8_t target = PADDLE_INIT_R;
+    if(state->ballActive && state->ballVelC > 0) {
+        PhysicsPos_t rowAt = state->ballPosR;
+        if(state->ballPosC < PADDLE_EDGE) {
+            rowAt = fold_row(state->ballPosR + (int32_t)state->ballVelR * (PADDLE_EDGE - state->ballPosC) / state->ballVelC);
+        }
+        /* Centre the paddle on the row, see paddle_covers. */
+        target = PHYSICS_PIXEL(rowAt) - (GEOMETRY_PADDLE_LENGTH - 1) / 2;
+        if(target < 0) {
+            target = 0;
+        } else if(target > PADDLE_MAX_R) {
+            target = PADDLE_MAX_R;
+        }
+    }
+
+    Input_t input = {
+        .north = !GEOMETRY_RELAY && state->paddleR > target,
+        .south = !GEOMETRY_RELAY && state->paddleR < target,
+        .west = false,
+        .east = false,
+        .push = false
+    };
+    return input;
+}
@@ -8,20 +8,43 @@
 #define PHYSICS_H
 
 #include "system.h"
+#include "input.h"
 
-/* Each led on the LED matrix is divided into 100 subpixels for ball movement. */
-#define PHYSICS_SUBPIXEL 100
+/* Each led on the LED matrix is divided into 128 subpixels for ball movement, so posistions are fixed point with 7 fractional bits and
+    the led a posistion is in is found with a shift, as the ATmega32U2 has no hardware divider. */
+#define PHYSICS_SUBPIXEL_SHIFT 7
+#define PHYSICS_SUBPIXEL (1 << PHYSICS_SUBPIXEL_SHIFT)
+/* The led a (non negative) posistion is in. */
+#define PHYSICS_PIXEL(pos) ((uint8_t)((pos) >> PHYSICS_SUBPIXEL_SHIFT))
+
+/* A ball posistion in subpixels. */
+typedef int16_t PhysicsPos_t;
+
+/* The ball is moved in fixed physics ticks at PHYSICS_RATE Hz, independent of the frame rate, with velocities in subpixels per tick.
+    Each frame runs as many ticks as the time since the last frame covers, up to PHYSICS_MAX_SUBSTEPS so a long frame can't stall the game
+    catching up. Raising the rate keeps the distance moved per tick, and so the accuracy of collisions, while speeding the ball up.
+    Both funkits must be built with the same rate. */
+#ifndef PHYSICS_RATE
+#define PHYSICS_RATE 50
+#endif
+#ifndef PHYSICS_MAX_SUBSTEPS
+#define PHYSICS_MAX_SUBSTEPS 8
+#endif
 
 /* Holds all state infomation for the ball and paddle physics. */
 typedef struct {
     bool ballActive;
+    bool ballExitBack;
     bool gameOver;
-    int16_t ballPosR;
-    int16_t ballPosC;
+    PhysicsPos_t ballPosR;
+    PhysicsPos_t ballPosC;
     int8_t ballVelR;
     int8_t ballVelC;
     int8_t paddleC;
     int8_t paddleR;
+    uint8_t paddleForwardTicks;
+    bool paddleBoost;
+    uint16_t tickAccumulator;
 } PhysicsState_t;
 
 /** Initalizes the physics state.
@@ -30,10 +53,32 @@ typedef struct {
 */
 PhysicsState_t physics_init(bool ballActive);
 
-/** Updates the state of the ball and paddle, handling collisions.
+/** Puts a ball handed over by another funkit on this board, given in this board's view.
  * @param currentState The current physics state.
+ * @param ballPosR The row posistion of the ball in subpixels.
+ * @param ballVelR The velocity of the ball in the row direction.
+ * @param ballVelC The velocity of the ball in the column direction.
+ * @param fromBack True if the ball crossed the back edge of this relay board, otherwise it crossed column 0.
+ * @param lateTicks The timer ticks since the ball left the other funkit, the ball is moved on by the physics ticks due in that time.
+ * @return The physics state with the ball active.
+*/
+PhysicsState_t physics_receive_ball(PhysicsState_t currentState, PhysicsPos_t ballPosR, int8_t ballVelR, int8_t ballVelC, bool fromBack, uint16_t lateTicks);
+
+/** Updates the state of the paddle from the input, then runs the physics ticks due in the elapsed time, handling collisions.
+ * This is a pure function of its arguments, so the same inputs always give the same state.
+ * @param currentState The current physics state.
+ * @param input The input for this frame.
+ * @param elapsed The time since the last update in timer ticks.
  * @return the new physics state.
 */
-PhysicsState_t physics_update(PhysicsState_t currentState);
+PhysicsState_t physics_update(PhysicsState_t currentState, Input_t input, uint16_t elapsed);
+
+/** Chooses the input an ai player gives, moving the paddle to where the ball will cross the paddle edge, or back to the middle while the
+ * ball is going away. The crossing is found in constant time, from the ball's path unfolded into a straight line and folded back between the
+ * side walls, rather than by stepping the ball. Relay boards have no paddle to move.
+ * @param state The physics state.
+ * @return The input, with only north or south set.
+*/
+Input_t physics_ai_input(const PhysicsState_t* state);
 
 #endif //PHYSICS_H
\ No newline at end of file
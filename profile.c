@@ -0,0 +1,130 @@
+/** @file profile.c
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Times each stage of the main loop with timer1, keeping min/max/average and overrun counts that can be dumped over the ir channel.
+*/
+
+#include "profile.h"
+#include "frame.h"
+#include "ir_queue.h"
+#include "stack.h"
+
+/* The statistics of one stage. Times are saturated to a byte, as a whole frame is well under 256 ticks at any useful refresh rate. */
+typedef struct {
+    uint8_t min;
+    uint8_t max;
+    uint8_t overruns;
+    uint16_t count;
+    uint32_t total;
+} ProfileStats_t;
+
+static ProfileStats_t stats[PROFILE_NUM_STAGES];
+static timer_tick_t frameBudget;
+
+/* The next frame to send in a dump, a stage, then PROFILE_NUM_STAGES for the stack frame, DUMP_DONE once the dump is finished. */
+#define DUMP_DONE (PROFILE_NUM_STAGES + 1)
+static uint8_t dumpStage = DUMP_DONE;
+
+/** Clears every stage's statistics.
+ * @param budget The ticks available to each stage, a stage taking longer than this counts as an overrun.
+*/
+void profile_init(timer_tick_t budget)
+{
+    frameBudget = budget;
+    dumpStage = DUMP_DONE;
+    for(uint8_t i = 0; i < PROFILE_NUM_STAGES; i++) {
+        stats[i].min = UINT8_MAX;
+        stats[i].max = 0;
+        stats[i].overruns = 0;
+        stats[i].count = 0;
+        stats[i].total = 0;
+    }
+}
+
+/** Records the time a stage took.
+ * @param stage The stage.
+ * @param start The time the stage started.
+ * @return The current time, the start of the next stage.
+*/
+timer_tick_t profile_record(ProfileStage_t stage, timer_tick_t start)
+{
+    timer_tick_t now = timer_get();
+    timer_tick_t duration = now - start;
+    ProfileStats_t* stageStats = &stats[stage];
+
+    if(duration > frameBudget && stageStats->overruns < UINT8_MAX) {
+        stageStats->overruns++;
+    }
+    uint8_t ticks = duration > UINT8_MAX ? UINT8_MAX : duration;
+    if(ticks < stageStats->min) {
+        stageStats->min = ticks;
+    }
+    if(ticks > stageStats->max) {
+        stageStats->max = ticks;
+    }
+
+    /* Halve the count and total before the count overflows, which keeps the average while weighting it towards recent frames. */
+    if(stageStats->count == UINT16_MAX) {
+        stageStats->count /= 2;
+        stageStats->total /= 2;
+    }
+    stageStats->count++;
+    stageStats->total += ticks;
+    return now;
+}
+
+/** Starts dumping the statistics over the ir channel, the dump is sent by profile_transmit over the following frames, one per stage then
+ * one for the stack. */
+void profile_dump(void)
+{
+    dumpStage = 0;
+}
+
+/** Checks if a dump is in progress.
+ * @return True if profile_transmit has more of a dump to send.
+*/
+bool profile_dumping_p(void)
+{
+    return dumpStage < DUMP_DONE;
+}
+
+/** Queues the next frame of a dump if one is in progress and the ir transmit buffer has room for it, should be called once per frame. */
+void profile_transmit(void)
+{
+    if(dumpStage >= DUMP_DONE) {
+        return;
+    }
+
+    uint8_t payload[PROFILE_DUMP_LENGTH];
+    uint8_t payloadLength;
+    if(dumpStage == PROFILE_NUM_STAGES) {
+        uint16_t unused = stack_unused();
+        uint16_t used = stack_used();
+        payload[0] = PROFILE_STACK_HEADER;
+        payload[1] = unused & 0xFF;
+        payload[2] = unused >> 8;
+        payload[3] = used & 0xFF;
+        payload[4] = used >> 8;
+        payloadLength = PROFILE_STACK_LENGTH;
+    } else {
+        const ProfileStats_t* stageStats = &stats[dumpStage];
+        uint16_t average = stageStats->count == 0 ? 0 : (stageStats->total << 4) / stageStats->count;
+        payload[0] = PROFILE_DUMP_HEADER;
+        payload[1] = dumpStage;
+        payload[2] = stageStats->count == 0 ? 0 : stageStats->min;
+        payload[3] = stageStats->max;
+        payload[4] = average & 0xFF;
+        payload[5] = average >> 8;
+        payload[6] = stageStats->overruns;
+        payloadLength = PROFILE_DUMP_LENGTH;
+    }
+
+    uint8_t frame[FRAME_MAX_LENGTH];
+    uint8_t frameLength = frame_encode(frame, payload, payloadLength);
+    if(ir_queue_write_space() < frameLength) {
+        return;
+    }
+    for(uint8_t i = 0; i < frameLength; i++) {
+        ir_queue_putc(frame[i]);
+    }
+    dumpStage++;
+}
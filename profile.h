@@ -0,0 +1,55 @@
+/** @file profile.h
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Times each stage of the main loop with timer1, keeping min/max/average and overrun counts that can be dumped over the ir channel.
+*/
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "system.h"
+#include "timer.h"
+#include "link.h"
+
+/* Dump frames are standard frames (see frame.h) whose first payload byte is PROFILE_DUMP_HEADER, which the link ignores (see link.h), so a dump
+    can be sent while the other funkit is listening. One frame is sent per stage: header, stage, min, max, average low byte, average high byte,
+    overruns. Times are in timer ticks (1024 cpu cycles), the average in sixteenths of a tick. */
+#define PROFILE_DUMP_HEADER (LINK_FOREIGN_FLAG | 0x01)
+#define PROFILE_DUMP_LENGTH 7
+/* The last frame of a dump reports the stack (see stack.h): header, unused low byte, unused high byte, used low byte, used high byte. */
+#define PROFILE_STACK_HEADER (LINK_FOREIGN_FLAG | 0x03)
+#define PROFILE_STACK_LENGTH 5
+
+/* The stages of the main loop that are timed, PROFILE_FRAME covers each scheduler slot (see scheduler.h) from the end of idle_wait. */
+typedef enum {
+    PROFILE_COMMUNICATION,
+    PROFILE_PHYSICS,
+    PROFILE_DISPLAY,
+    PROFILE_FRAME,
+    PROFILE_NUM_STAGES
+} ProfileStage_t;
+
+/** Clears every stage's statistics.
+ * @param budget The ticks available to each stage, a stage taking longer than this counts as an overrun.
+*/
+void profile_init(timer_tick_t budget);
+
+/** Records the time a stage took.
+ * @param stage The stage.
+ * @param start The time the stage started.
+ * @return The current time, the start of the next stage.
+*/
+timer_tick_t profile_record(ProfileStage_t stage, timer_tick_t start);
+
+/** Starts dumping the statistics over the ir channel, the dump is sent by profile_transmit over the following frames, one per stage then
+ * one for the stack. */
+void profile_dump(void);
+
+/** Checks if a dump is in progress.
+ * @return True if profile_transmit has more of a dump to send.
+*/
+bool profile_dumping_p(void);
+
+/** Queues the next frame of a dump if one is in progress and the ir transmit buffer has room for it, should be called once per frame. */
+void profile_transmit(void);
+
+#endif //PROFILE_H
\ No newline at end of file
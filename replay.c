@@ -0,0 +1,185 @@
+/** @file replay.c
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Records the inputs, frame times and recieved events of a match to eeprom, so the match can be played back through the physics on a pc.
+*/
+
+#include "replay.h"
+#include <avr/eeprom.h>
+
+/* Bytes of eeprom the record can take, the last is kept for the end tag. */
+#define REPLAY_SIZE (E2END + 1)
+/* Number of bytes waiting to be written to eeprom, must be a power of two so the indexes can wrap with a mask. */
+#define BUFFER_SIZE 16
+#define BUFFER_MASK (BUFFER_SIZE - 1)
+
+_Static_assert(REPLAY_EVENT_START_GAME == COMMUNICATION_START_GAME && REPLAY_EVENT_BALL == COMMUNICATION_BALL
+    && REPLAY_EVENT_END_ROUND == COMMUNICATION_END_ROUND && REPLAY_EVENT_GAME_OVER == COMMUNICATION_GAME_OVER,
+    "replay event kinds are the communication event types");
+
+/* Bytes of the record waiting to be written, one slot is always left empty to tell a full buffer from an empty one. */
+static uint8_t buffer[BUFFER_SIZE];
+static uint8_t bufferHead = 0;
+static uint8_t bufferTail = 0;
+
+/* The eeprom address the next byte is written to. */
+static uint16_t writeAddress = 0;
+/* The length of the record, including the bytes still in the buffer. */
+static uint16_t recordLength = 0;
+/* Whether a match is being recorded, from the first game start until a record doesn't fit. */
+static bool recording = false;
+/* Whether the end tag has been written after the last byte of the record. */
+static bool ended = true;
+
+/* Frames with no input as long as the frame before, not yet added to the record as a run. */
+static uint8_t runFrames = 0;
+/* The length of the last frame recorded in timer ticks. */
+static uint16_t lastElapsed = 0;
+/* Whether a frame has been recorded since the last replay_update, the run is added once the physics stops. */
+static bool frameRecorded = false;
+
+/** Starts waiting for a match to record, nothing is written until the first game start. */
+void replay_init(void)
+{
+    bufferHead = 0;
+    bufferTail = 0;
+    writeAddress = 0;
+    recordLength = 0;
+    recording = false;
+    ended = true;
+    runFrames = 0;
+    lastElapsed = 0;
+    frameRecorded = false;
+}
+
+/** Adds a record to the buffer, if it doesn't fit the recording ends there so the record never has a gap.
+ * @param data The record.
+ * @param length The length of the record.
+*/
+static void replay_append(const uint8_t* data, uint8_t length)
+{
+    if(!recording) {
+        return;
+    }
+    uint8_t space = (bufferTail - bufferHead - 1) & BUFFER_MASK;
+    if(length > space || recordLength + length > REPLAY_SIZE - 1) {
+        recording = false;
+        return;
+    }
+
+    for(uint8_t i = 0; i < length; i++) {
+        buffer[bufferHead] = data[i];
+        bufferHead = (bufferHead + 1) & BUFFER_MASK;
+    }
+    recordLength += length;
+    ended = false;
+}
+
+/** Adds the frames waiting to be recorded as a run, if there are any. */
+static void replay_flush_run(void)
+{
+    if(runFrames > 0) {
+        uint8_t tag = runFrames - 1;
+        replay_append(&tag, 1);
+        runFrames = 0;
+    }
+}
+
+/** Records an event recieved from the other funkits.
+ * @param event The event.
+ * @param ball The state of the ball for a COMMUNICATION_BALL event.
+*/
+void replay_record_event(CommunicationEvent_t event, const CommunicationBall_t* ball)
+{
+    if(event.type == COMMUNICATION_START_GAME && recordLength == 0) {
+        recording = true;
+    }
+    replay_flush_run();
+
+    uint8_t record[1 + REPLAY_BALL_LENGTH];
+    uint8_t length = 1;
+    record[0] = REPLAY_EVENT(event.type, event.type == COMMUNICATION_START_GAME ? event.haveBall : event.fromBack);
+    if(event.type == COMMUNICATION_BALL) {
+        record[1] = (uint16_t)ball->ballPosR & 0xFF;
+        record[2] = (uint16_t)ball->ballPosR >> 8;
+        record[3] = (uint8_t)ball->ballVelR;
+        record[4] = (uint8_t)ball->ballVelC;
+        record[5] = ball->hopFrames;
+        length += REPLAY_BALL_LENGTH;
+    } else if(event.type == COMMUNICATION_START_GAME) {
+        lastElapsed = 0;
+    }
+    replay_append(record, length);
+}
+
+/** Records a frame the physics was run for.
+ * @param input The input given to physics_update.
+ * @param elapsed The elapsed time given to physics_update.
+*/
+void replay_record_frame(Input_t input, uint16_t elapsed)
+{
+    if(!recording) {
+        return;
+    }
+    frameRecorded = true;
+
+    uint8_t inputs = (input.north ? REPLAY_INPUT_NORTH : 0) | (input.south ? REPLAY_INPUT_SOUTH : 0) | (input.west ? REPLAY_INPUT_WEST : 0)
+        | (input.east ? REPLAY_INPUT_EAST : 0) | (input.push ? REPLAY_INPUT_PUSH : 0);
+    if(inputs == 0 && elapsed == lastElapsed) {
+        if(++runFrames == REPLAY_RUN_MAX) {
+            replay_flush_run();
+        }
+        return;
+    }
+    replay_flush_run();
+
+    /* Frames are paced to a fixed period, so the length rarely changes and then only by a few ticks. */
+    int16_t delta = (int16_t)(elapsed - lastElapsed);
+    uint8_t record[3];
+    uint8_t length;
+    if(delta == 0) {
+        record[0] = REPLAY_TAG_INPUT | inputs;
+        length = 1;
+    } else if(delta >= INT8_MIN && delta <= INT8_MAX) {
+        record[0] = REPLAY_TAG_DELTA | inputs;
+        record[1] = (uint8_t)delta;
+        length = 2;
+    } else {
+        record[0] = REPLAY_TAG_ELAPSED | inputs;
+        record[1] = elapsed & 0xFF;
+        record[2] = elapsed >> 8;
+        length = 3;
+    }
+    lastElapsed = elapsed;
+    replay_append(record, length);
+}
+
+/** Writes the next byte of the record to eeprom if the last write has finished, should be called once per frame. An eeprom write takes
+    about 3.4ms, so a byte a frame keeps the main loop from waiting on one. */
+void replay_update(void)
+{
+    if(!frameRecorded) {
+        replay_flush_run();
+    }
+    frameRecorded = false;
+
+    if(!eeprom_is_ready()) {
+        return;
+    }
+    if(bufferHead != bufferTail) {
+        eeprom_write_byte((uint8_t*)(uintptr_t)writeAddress, buffer[bufferTail]);
+        bufferTail = (bufferTail + 1) & BUFFER_MASK;
+        writeAddress++;
+    } else if(!ended) {
+        /* The end tag is written once the buffer is empty, and overwritten by the next byte. */
+        eeprom_write_byte((uint8_t*)(uintptr_t)writeAddress, REPLAY_TAG_END);
+        ended = true;
+    }
+}
+
+/** Checks if there is more of the record to write.
+ * @return True if replay_update has bytes left to write.
+*/
+bool replay_writing_p(void)
+{
+    return bufferHead != bufferTail || !ended || runFrames > 0;
+}
@@ -0,0 +1,71 @@
+/** @file replay.h
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Records the inputs, frame times and recieved events of a match to eeprom, so the match can be played back through the physics on a pc.
+*/
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "system.h"
+#include "input.h"
+#include "communication.h"
+
+/* A match is recorded from the start of eeprom, from the first game start after power on, so the last match is kept until the next one starts.
+    physics_update is a pure function of the state, input and elapsed time, so with the game starts and balls recieved this is all that is
+    needed to play the match back. The record is a run of records, each starting with a tag byte:
+        0nnnnnnn            n + 1 frames with no input, each as long as the frame before.
+        100iiiii            a frame with the inputs i (REPLAY_INPUT_*), as long as the frame before.
+        101iiiii d          a frame with the inputs i, d ticks longer than the frame before as a signed byte.
+        110iiiii lo hi      a frame with the inputs i, lo | hi << 8 ticks long.
+        1110kkkf ...        an event of kind k (REPLAY_EVENT_*) with the flag f, a ball is followed by its row posistion low and high bytes,
+                            row and column velocities and hop frames (see CommunicationBall_t).
+        11111111            the end of the record, which is also what erased eeprom reads.
+    Only frames where the physics ran are recorded, and the frame before a game start is taken as 0 ticks long. */
+#define REPLAY_RUN_MAX 0x80
+#define REPLAY_TAG_INPUT 0x80
+#define REPLAY_TAG_DELTA 0xA0
+#define REPLAY_TAG_ELAPSED 0xC0
+#define REPLAY_TAG_EVENT 0xE0
+#define REPLAY_TAG_END 0xFF
+#define REPLAY_TAG_INPUT_MASK 0x1F
+#define REPLAY_TAG_KIND_MASK 0xE0
+
+#define REPLAY_INPUT_NORTH BIT(0)
+#define REPLAY_INPUT_SOUTH BIT(1)
+#define REPLAY_INPUT_WEST BIT(2)
+#define REPLAY_INPUT_EAST BIT(3)
+#define REPLAY_INPUT_PUSH BIT(4)
+
+/* Event kinds, f is whether this board starts with the ball for a game start, otherwise whether the event came over the back edge. */
+#define REPLAY_EVENT_START_GAME 0
+#define REPLAY_EVENT_BALL 1
+#define REPLAY_EVENT_END_ROUND 2
+#define REPLAY_EVENT_GAME_OVER 3
+#define REPLAY_EVENT(kind, flag) (REPLAY_TAG_EVENT | ((kind) << 1) | (flag))
+#define REPLAY_BALL_LENGTH 5
+
+/** Starts waiting for a match to record, nothing is written until the first game start. */
+void replay_init(void);
+
+/** Records an event recieved from the other funkits.
+ * @param event The event.
+ * @param ball The state of the ball for a COMMUNICATION_BALL event.
+*/
+void replay_record_event(CommunicationEvent_t event, const CommunicationBall_t* ball);
+
+/** Records a frame the physics was run for.
+ * @param input The input given to physics_update.
+ * @param elapsed The elapsed time given to physics_update.
+*/
+void replay_record_frame(Input_t input, uint16_t elapsed);
+
+/** Writes the next byte of the record to eeprom if the last write has finished, should be called once per frame. An eeprom write takes
+    about 3.4ms, so a byte a frame keeps the main loop from waiting on one. */
+void replay_update(void);
+
+/** Checks if there is more of the record to write.
+ * @return True if replay_update has bytes left to write.
+*/
+bool replay_writing_p(void);
+
+#endif //REPLAY_H
\ No newline at end of file
@@ -0,0 +1,43 @@
+/** @file scheduler.c
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Runs the tasks of the main loop cooperatively at their own rates, in the slots the pacer (see idle.h) divides time into.
+*/
+
+#include "scheduler.h"
+#include <avr/pgmspace.h>
+
+static const SchedulerTask_t* taskTable;
+static uint8_t taskCount = 0;
+/* The slot each task is next due in. Slots are counted in a byte that wraps, so deadlines are compared by their signed distance from
+    the current slot, which only works while periods are under 128 slots. */
+static uint8_t deadlines[SCHEDULER_MAX_TASKS];
+static uint8_t slot = 0;
+
+/** Starts the scheduler at slot 0, with each task first due at its offset.
+ * @param tasks The task table, in program memory.
+ * @param numTasks The number of tasks in the table, at most SCHEDULER_MAX_TASKS.
+*/
+void scheduler_init(const SchedulerTask_t* tasks, uint8_t numTasks)
+{
+    taskTable = tasks;
+    taskCount = numTasks > SCHEDULER_MAX_TASKS ? SCHEDULER_MAX_TASKS : numTasks;
+    slot = 0;
+    for(uint8_t i = 0; i < taskCount; i++) {
+        deadlines[i] = pgm_read_byte(&tasks[i].offset);
+    }
+}
+
+/** Runs the tasks due in the current slot, then moves on to the next slot, should be called once each time the pacer wakes. */
+void scheduler_run(void)
+{
+    for(uint8_t i = 0; i < taskCount; i++) {
+        if((int8_t)(slot - deadlines[i]) < 0) {
+            continue;
+        }
+        /* Slots only move on here, so a slot that overran or was slept through only delays the tasks after it, they keep their phase. */
+        deadlines[i] += pgm_read_byte(&taskTable[i].period);
+        void (*run)(void) = (void (*)(void))pgm_read_ptr(&taskTable[i].run);
+        run();
+    }
+    slot++;
+}
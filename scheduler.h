@@ -0,0 +1,31 @@
+/** @file scheduler.h
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Runs the tasks of the main loop cooperatively at their own rates, in the slots the pacer (see idle.h) divides time into.
+*/
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "system.h"
+
+/* The most tasks a table can hold. */
+#define SCHEDULER_MAX_TASKS 8
+
+/* A task run every period slots, first in slot offset. Task tables are kept in flash (PROGMEM). Tasks run to completion, so each should leave
+    time in its slot for the others due with it, which run in table order. */
+typedef struct {
+    void (*run)(void);
+    uint8_t period;
+    uint8_t offset;
+} SchedulerTask_t;
+
+/** Starts the scheduler at slot 0, with each task first due at its offset.
+ * @param tasks The task table, in program memory.
+ * @param numTasks The number of tasks in the table, at most SCHEDULER_MAX_TASKS.
+*/
+void scheduler_init(const SchedulerTask_t* tasks, uint8_t numTasks);
+
+/** Runs the tasks due in the current slot, then moves on to the next slot, should be called once each time the pacer wakes. */
+void scheduler_run(void);
+
+#endif //SCHEDULER_H
\ No newline at end of file
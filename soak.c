@@ -0,0 +1,191 @@
+/** @file soak.c
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Ir soak test, keeps the link's window full of sequenced test messages to the other funkit and measures the throughput and loss of
+    the ir channel over each SOAK_WINDOW_FRAMES, so the link (see link.h) can be tuned from measured data. Both funkits run the test at once.
+*/
+
+#include "soak.h"
+#include "frame.h"
+#include "ir_queue.h"
+
+/* The bytes after the sequence number of a test message are the sequence number's low byte plus a multiple of FILL_STEP, which over a run
+    of messages gives every byte value, including the frame codes that have to be escaped (see frame.h). */
+#define SEQUENCE_LENGTH 2
+#define FILL_STEP 0x55
+
+static FrameDecoder_t decoder;
+static uint8_t rate;
+
+/* The sequence number of the next test message to send, and of the next expected from the other funkit, which is taken from the first
+    message recieved so a funkit that was reset alone is caught up. */
+static uint16_t sendSequence;
+static uint16_t receiveSequence;
+static bool receiving;
+
+/* The counts of the window so far, from the link's counts at its start. */
+static uint8_t windowFrames;
+static LinkStats_t windowStart;
+static uint16_t windowBytes;
+static uint8_t windowErrors;
+
+static SoakResult_t result;
+static bool dumpPending;
+
+/** Initializes the ir channel and the link and clears the counts, both funkits must initialize together.
+ * @param frameRate The rate soak_update is called at, in frames per second.
+*/
+void soak_init(uint8_t frameRate)
+{
+    ir_queue_init();
+    link_init();
+    frame_decoder_init(&decoder);
+    rate = frameRate;
+    sendSequence = 0;
+    receiveSequence = 0;
+    receiving = false;
+    windowFrames = 0;
+    windowStart = *link_stats(LINK_PEER_FRONT);
+    windowBytes = 0;
+    windowErrors = 0;
+    result = (SoakResult_t){0};
+    dumpPending = false;
+}
+
+/** Fills in the data of a test message.
+ * @param data The message data, LINK_MAX_MESSAGE bytes.
+ * @param sequence The message's sequence number.
+*/
+static void soak_fill(uint8_t* data, uint16_t sequence)
+{
+    data[0] = sequence & 0xFF;
+    data[1] = sequence >> 8;
+    for(uint8_t i = SEQUENCE_LENGTH; i < LINK_MAX_MESSAGE; i++) {
+        data[i] = (sequence & 0xFF) + i * FILL_STEP;
+    }
+}
+
+/** Checks a recieved test message is the next in sequence and intact, counting its data.
+ * @param message The message.
+*/
+static void soak_check(const LinkMessage_t* message)
+{
+    uint8_t expected[LINK_MAX_MESSAGE];
+    uint16_t sequence = message->length < SEQUENCE_LENGTH ? 0 : message->data[0] | (message->data[1] << 8);
+    if(!receiving) {
+        receiving = true;
+        receiveSequence = sequence;
+    }
+    soak_fill(expected, receiveSequence);
+
+    bool intact = message->type == SOAK_MESSAGE_TYPE && message->length == LINK_MAX_MESSAGE;
+    for(uint8_t i = 0; intact && i < LINK_MAX_MESSAGE; i++) {
+        intact = message->data[i] == expected[i];
+    }
+    if(!intact && windowErrors < UINT8_MAX) {
+        windowErrors++;
+    }
+    /* Carry on from the message recieved, so one error isn't counted again for every message after it. */
+    receiveSequence = sequence + 1;
+    windowBytes += message->length;
+}
+
+/** The change in a running count over the window, saturated to a byte.
+ * @param now The count now.
+ * @param start The count at the start of the window.
+ * @return The change.
+*/
+static uint8_t soak_count(uint16_t now, uint16_t start)
+{
+    uint16_t count = now - start;
+    return count > UINT8_MAX ? UINT8_MAX : count;
+}
+
+/** Takes the window's counts as the result and starts the next window. */
+static void soak_finish_window(void)
+{
+    const LinkStats_t* stats = link_stats(LINK_PEER_FRONT);
+    result.bytesPerSecond = (uint32_t)windowBytes * rate / SOAK_WINDOW_FRAMES;
+    result.sent = soak_count(stats->sent, windowStart.sent);
+    result.acked = soak_count(stats->acked, windowStart.acked);
+    result.resent = soak_count(stats->resent, windowStart.resent);
+    result.lost = soak_count(stats->lost, windowStart.lost);
+    result.duplicates = soak_count(stats->duplicates, windowStart.duplicates);
+    result.errors = windowErrors;
+    result.lossPercent = result.acked == 0 ? 0 : result.lost * 100 / result.acked;
+
+    windowFrames = 0;
+    windowStart = *stats;
+    windowBytes = 0;
+    windowErrors = 0;
+    dumpPending = true;
+}
+
+/** Queues the dump of the last result if one is waiting and the ir transmit buffer has room for it. */
+static void soak_transmit_dump(void)
+{
+    if(!dumpPending) {
+        return;
+    }
+
+    uint8_t payload[SOAK_DUMP_LENGTH] = {
+        SOAK_DUMP_HEADER,
+        result.bytesPerSecond > UINT8_MAX ? UINT8_MAX : result.bytesPerSecond,
+        result.sent,
+        result.acked,
+        result.resent,
+        result.lost,
+        result.duplicates,
+        result.errors
+    };
+
+    uint8_t frame[FRAME_MAX_LENGTH];
+    uint8_t frameLength = frame_encode(frame, payload, SOAK_DUMP_LENGTH);
+    if(ir_queue_write_space() < frameLength) {
+        return;
+    }
+    for(uint8_t i = 0; i < frameLength; i++) {
+        ir_queue_putc(frame[i]);
+    }
+    dumpPending = false;
+}
+
+/** Handles every frame recieved from the other funkit, sends as many test messages as the link's window allows, and finishes a result
+ * every SOAK_WINDOW_FRAMES, should be called once per frame.
+ * @param sending Whether to send test messages, the other funkit's messages are recieved and acknowledged either way.
+*/
+void soak_update(bool sending)
+{
+    while(ir_queue_read_ready_p()) {
+        if(frame_decode(&decoder, ir_queue_getc()) == FRAME_COMPLETE) {
+            link_receive_frame(decoder.payload, decoder.length);
+        }
+    }
+    LinkMessage_t message;
+    while(link_read(LINK_PEER_FRONT, &message)) {
+        soak_check(&message);
+    }
+
+    link_update();
+    uint8_t data[LINK_MAX_MESSAGE];
+    soak_fill(data, sendSequence);
+    while(sending && link_send(LINK_PEER_FRONT, SOAK_MESSAGE_TYPE, data, LINK_MAX_MESSAGE)) {
+        soak_fill(data, ++sendSequence);
+    }
+    /* The dump goes first so a full window of test messages can't hold it back. */
+    soak_transmit_dump();
+    while(link_transmit()) {
+        continue;
+    }
+
+    if(++windowFrames == SOAK_WINDOW_FRAMES) {
+        soak_finish_window();
+    }
+}
+
+/** The result of the last finished window.
+ * @return The result, all zero before the first window finishes.
+*/
+const SoakResult_t* soak_result(void)
+{
+    return &result;
+}
@@ -0,0 +1,57 @@
+/** @file soak.h
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Ir soak test, keeps the link's window full of sequenced test messages to the other funkit and measures the throughput and loss of
+    the ir channel over each SOAK_WINDOW_FRAMES, so the link (see link.h) can be tuned from measured data. Both funkits run the test at once.
+*/
+
+#ifndef SOAK_H
+#define SOAK_H
+
+#include "system.h"
+#include "link.h"
+
+/* The link message type of the test messages, each holds a 16 bit sequence number followed by bytes made from it, so a corrupted or
+    missing message is caught. */
+#define SOAK_MESSAGE_TYPE 0
+/* The frames each result is measured over. */
+#define SOAK_WINDOW_FRAMES 100
+
+/* Each result is dumped over the ir channel in a standard frame (see frame.h) whose first payload byte is SOAK_DUMP_HEADER, which the link
+    ignores (see link.h): header, bytes per second saturated to a byte (the channel carries at most 240), sent, acked, resent, lost,
+    duplicates, errors. */
+#define SOAK_DUMP_HEADER (LINK_FOREIGN_FLAG | 0x02)
+#define SOAK_DUMP_LENGTH 8
+
+/* The result of one window. The counts are of the link's message frames, sent and resent by this funkit and duplicates recieved from the
+    other, and of this funkit's messages acknowledged and lost (see LinkStats_t), each saturating at 255. Errors are test messages recieved
+    out of sequence or corrupted, which the link should never deliver. The throughput is of test message data recieved, and the loss the share
+    of messages acknowledged whose first copy or its acknowledgement was lost. A resend for an acknowledgement that was only late isn't loss,
+    it is counted in resent alone. */
+typedef struct {
+    uint16_t bytesPerSecond;
+    uint8_t lossPercent;
+    uint8_t sent;
+    uint8_t acked;
+    uint8_t resent;
+    uint8_t lost;
+    uint8_t duplicates;
+    uint8_t errors;
+} SoakResult_t;
+
+/** Initializes the ir channel and the link and clears the counts, both funkits must initialize together.
+ * @param frameRate The rate soak_update is called at, in frames per second.
+*/
+void soak_init(uint8_t frameRate);
+
+/** Handles every frame recieved from the other funkit, sends as many test messages as the link's window allows, and finishes a result
+ * every SOAK_WINDOW_FRAMES, should be called once per frame.
+ * @param sending Whether to send test messages, the other funkit's messages are recieved and acknowledged either way.
+*/
+void soak_update(bool sending);
+
+/** The result of the last finished window.
+ * @return The result, all zero before the first window finishes.
+*/
+const SoakResult_t* soak_result(void);
+
+#endif //SOAK_H
\ No newline at end of file
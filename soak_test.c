@@ -0,0 +1,90 @@
+/**  @file   soak_test.c
+     @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+     @brief  Main c file of the ir soak test, runs the test of soak.h on both funkits and shows each result on the led matrix.
+ */
+
+#include "system.h"
+#include "framebuffer.h"
+#include "idle.h"
+#include "input.h"
+#include "geometry.h"
+#include "soak.h"
+
+/* Constants. */
+#define REFRESH_RATE 50
+#define NUM_COLS FRAMEBUFFER_NUM_COLS
+/* Rows of the led matrix. */
+#define NUM_ROWS 7
+/* The throughput that fills the throughput bar, a little over the test data the ir baud rate of 240 bytes per second carries one way, as
+    each 11 byte message frame holds 5 bytes of data. */
+#define FULL_SCALE_RATE 112
+/* The column between the throughput bar and the loss bar, which shows the test is sending, lit at the first row, and errors, lit at the last row. */
+#define STATUS_COL 2
+
+#if GEOMETRY_SEAM != 0 || GEOMETRY_RELAY
+#error "the soak test is only between two funkits"
+#endif
+
+/** The rows of a bar showing a value, lit from the last row, with any value above zero lighting at least one row.
+ * @param value The value.
+ * @param fullScale The value that lights every row.
+ * @return The bitmask of lit rows.
+*/
+static uint8_t bar_pattern(uint16_t value, uint16_t fullScale)
+{
+    uint8_t rows = value >= fullScale ? NUM_ROWS : ((uint32_t)value * NUM_ROWS + fullScale - 1) / fullScale;
+    return (BIT(NUM_ROWS) - 1) & ~(BIT(NUM_ROWS - rows) - 1);
+}
+
+/** Builds the column showing part of a result.
+ * @param result The result.
+ * @param sending Whether the test is sending.
+ * @param col The column.
+ * @return The bitmask of lit rows.
+*/
+static uint8_t soak_column(const SoakResult_t* result, bool sending, uint8_t col)
+{
+    if(col < STATUS_COL) {
+        return bar_pattern(result->bytesPerSecond, FULL_SCALE_RATE);
+    }
+    if(col > STATUS_COL) {
+        return bar_pattern(result->lossPercent, 100);
+    }
+    return (sending ? BIT(0) : 0) | (result->errors > 0 ? BIT(NUM_ROWS - 1) : 0);
+}
+
+/** Entry point. */
+int main (void)
+{
+    system_init ();
+    input_init();
+    ledscan_init();
+    framebuffer_init();
+    idle_init(REFRESH_RATE);
+    soak_init(REFRESH_RATE);
+
+    /* Pushing the navswitch stops and starts sending, so one funkit can send alone to measure one way. */
+    bool sending = true;
+    uint8_t lastColumns[NUM_COLS] = {0};
+
+    while (1)
+    {
+        idle_wait(false);
+        if(input_update().push) {
+            sending = !sending;
+        }
+        soak_update(sending);
+
+        for(uint8_t col = 0; col < NUM_COLS; col++) {
+            uint8_t pattern = soak_column(soak_result(), sending, col);
+            if(pattern != lastColumns[col]) {
+                framebuffer_invalidate(col);
+                lastColumns[col] = pattern;
+            }
+            if(framebuffer_dirty_p(col)) {
+                framebuffer_draw_column(col, pattern);
+            }
+        }
+        framebuffer_present();
+    }
+}
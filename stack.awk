@@ -0,0 +1,92 @@
+# File:   stack.awk
+# Authors: Nicholas Grace (ngr55), Jack Miller (jmi145)
+# Descr:  Worst case stack of the game, from the call graphs gcc writes with -fcallgraph-info=su (see make memory). Each function's stack
+#         is its own frame, which includes its return address and saved registers, plus the deepest of the functions it calls. The worst
+#         case is the deepest chain from main plus the deepest interrupt, as interrupts don't nest. Calls through a pointer go to the
+#         functions named in tasks, the scheduler's task table, as the call graph can't follow them. Functions with no call graph, such as
+#         the library's arithmetic routines, and recursion can't be counted, so they are listed after the total.
+#         Static functions are named with their file, as gcc names them.
+#         Usage: awk -v tasks="game.c:game_task game.c:render_task" -f stack.awk *.ci
+
+# The value of a quoted field of a node or edge line.
+function field(line, key,    start, rest)
+{
+    start = index(line, key ": \"")
+    rest = substr(line, start + length(key) + 3)
+    return substr(rest, 1, index(rest, "\"") - 1)
+}
+
+# The stack a function needs, also setting path[f] to the chain of calls it takes.
+function depth(f,    callees, n, i, d, best, bestCallee)
+{
+    if(f in memo) {
+        return memo[f]
+    }
+    if(!(f in frame)) {
+        uncounted[f] = 1
+        path[f] = f
+        return 0
+    }
+    if(f in active) {
+        recursive[f] = 1
+        return 0
+    }
+    active[f] = 1
+    best = 0
+    bestCallee = ""
+    n = split(calls[f], callees, " ")
+    for(i = 1; i <= n; i++) {
+        d = depth(callees[i])
+        if(bestCallee == "" || d > best) {
+            best = d
+            bestCallee = callees[i]
+        }
+    }
+    delete active[f]
+    memo[f] = frame[f] + best
+    path[f] = bestCallee == "" ? f : f " > " path[bestCallee]
+    return memo[f]
+}
+
+/^node:/ {
+    name = field($0, "title")
+    if(match($0, /[0-9]+ bytes/)) {
+        frame[name] = substr($0, RSTART, RLENGTH) + 0
+        if(index($0, "dynamic") && !index($0, "bounded")) {
+            uncounted[name " (dynamic frame)"] = 1
+        }
+        if(name ~ /^__vector_/) {
+            vectors[name] = 1
+        }
+    }
+}
+
+/^edge:/ {
+    callee = field($0, "targetname")
+    calls[field($0, "sourcename")] = calls[field($0, "sourcename")] " " (callee == "__indirect_call" ? tasks : callee)
+}
+
+END {
+    total = depth("main")
+    printf "main: %d bytes, %s\n", total, path["main"]
+    deepest = ""
+    for(v in vectors) {
+        if(deepest == "" || depth(v) > depth(deepest)) {
+            deepest = v
+        }
+    }
+    if(deepest != "") {
+        printf "deepest interrupt: %d bytes, %s\n", depth(deepest), path[deepest]
+        total += depth(deepest)
+    }
+    printf "worst case stack: %d bytes\n", total
+    for(f in uncounted) {
+        list = list " " f
+    }
+    for(f in recursive) {
+        list = list " " f " (recursive)"
+    }
+    if(list != "") {
+        printf "not counted:%s\n", list
+    }
+}
@@ -0,0 +1,44 @@
+/** @file stack.c
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Measures the most stack the program has used, by painting the free ram with a known byte before main and looking for the lowest
+    byte the stack has overwritten. The ram each module takes for its variables is reported by make memory.
+*/
+
+#include "stack.h"
+
+/* Set by the linker, _end is the first byte after the variables and __stack the last byte of ram, where the stack starts. Nothing is
+    allocated from the heap, so everything between is free for the stack. */
+extern uint8_t _end;
+extern uint8_t __stack;
+
+/** Paints the free ram before main. It is placed in .init3, after the startup code has cleared the zero register and set the stack pointer
+ * but before anything has been called, and is naked so it falls through to the rest of the startup code rather than returning.
+*/
+void stack_paint(void) __attribute__((naked, used, section(".init3")));
+void stack_paint(void)
+{
+    for(uint8_t* byte = &_end; byte <= &__stack; byte++) {
+        *byte = STACK_PAINT;
+    }
+}
+
+/** The smallest the free ram between the variables and the stack has been since reset, a scan of up to all of it so it should only be
+ * called now and then.
+ * @return The bytes never used.
+*/
+uint16_t stack_unused(void)
+{
+    const uint8_t* byte = &_end;
+    while(byte <= &__stack && *byte == STACK_PAINT) {
+        byte++;
+    }
+    return byte - &_end;
+}
+
+/** The most stack used since reset, by interrupts as well as the main loop.
+ * @return The bytes used.
+*/
+uint16_t stack_used(void)
+{
+    return &__stack - &_end + 1 - stack_unused();
+}
@@ -0,0 +1,26 @@
+/** @file stack.h
+    @author Nicholas Grace (ngr55), Jack Miller (jmi145)
+    @brief Measures the most stack the program has used, by painting the free ram with a known byte before main and looking for the lowest
+    byte the stack has overwritten. The ram each module takes for its variables is reported by make memory.
+*/
+
+#ifndef STACK_H
+#define STACK_H
+
+#include "system.h"
+
+/* The byte the free ram is painted with, any byte the stack uses is very unlikely to be left holding it. */
+#define STACK_PAINT 0xC5
+
+/** The smallest the free ram between the variables and the stack has been since reset, a scan of up to all of it so it should only be
+ * called now and then.
+ * @return The bytes never used.
+*/
+uint16_t stack_unused(void);
+
+/** The most stack used since reset, by interrupts as well as the main loop.
+ * @return The bytes used.
+*/
+uint16_t stack_used(void);
+
+#endif //STACK_H
\ No newline at end of file